@@ -0,0 +1,78 @@
+#include "batcher.h"
+
+bool batcher_init(struct batcher_t* batcher) {
+    atomic_init(&batcher->epoch, 0);
+    batcher->remaining = 0;
+    batcher->blocked = 0;
+    batcher->exclusive = false;
+    batcher->exclusive_tickets = 0;
+    batcher->exclusive_served = 0;
+    return lock_init(&batcher->lock);
+}
+
+void batcher_cleanup(struct batcher_t* batcher) {
+    lock_cleanup(&batcher->lock);
+}
+
+size_t batcher_get_epoch(struct batcher_t* batcher) {
+    return atomic_load(&batcher->epoch);
+}
+
+bool batcher_enter(struct batcher_t* batcher) {
+    if (!lock_acquire(&batcher->lock))
+        return false;
+    if (batcher->remaining == 0) { // no running epoch, start one right away
+        batcher->remaining = 1;
+    } else { // wait for the running epoch to end, we're then let in
+        size_t epoch = atomic_load(&batcher->epoch);
+        batcher->blocked++;
+        // exclusive epochs may be run first, none of them lets us in
+        while (atomic_load(&batcher->epoch) == epoch || batcher->exclusive) {
+            epoch = atomic_load(&batcher->epoch);
+            lock_wait(&batcher->lock);
+        }
+    }
+    lock_release(&batcher->lock);
+    return true;
+}
+
+bool batcher_enter_exclusive(struct batcher_t* batcher) {
+    if (!lock_acquire(&batcher->lock))
+        return false;
+    size_t ticket = batcher->exclusive_tickets++;
+    if (batcher->remaining == 0) { // no running epoch, start ours right away
+        batcher->remaining = 1;
+        batcher->exclusive = true;
+        batcher->exclusive_served++;
+    } else { // wait for our turn, at the end of some epoch
+        while (batcher->exclusive_served <= ticket)
+            lock_wait(&batcher->lock);
+    }
+    lock_release(&batcher->lock);
+    return true;
+}
+
+void batcher_leave(struct batcher_t* batcher, batcher_epoch_end_t on_end, void* arg) {
+    lock_acquire(&batcher->lock);
+    if (batcher->remaining == 1) { // last one out
+        // still counted meanwhile, so that the epoch-end work runs while the
+        // batcher looks busy (e.g. to hardware transactions)
+        if (on_end)
+            on_end(arg);
+        if (batcher->exclusive_served < batcher->exclusive_tickets) {
+            // the next exclusive epoch, the others keep waiting
+            batcher->remaining = 1;
+            batcher->exclusive = true;
+            batcher->exclusive_served++;
+        } else {
+            batcher->remaining = batcher->blocked;
+            batcher->blocked = 0;
+            batcher->exclusive = false;
+        }
+        atomic_fetch_add(&batcher->epoch, 1);
+        lock_wake_up(&batcher->lock);
+    } else {
+        batcher->remaining--;
+    }
+    lock_release(&batcher->lock);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "lock.h"
+
+/**
+ * @brief A batcher groups transactions into epochs. A transaction entering
+ * while an epoch is running waits for the next one; the last transaction to
+ * leave an epoch runs the epoch-end work, then lets the waiting ones in.
+ * A transaction can also ask for an exclusive epoch, where it runs alone;
+ * those are served first, in arrival order.
+ */
+struct batcher_t {
+    struct lock_t lock;
+    atomic_size_t epoch;       // current epoch number
+    size_t remaining;          // transactions still inside the current epoch
+    size_t blocked;            // transactions waiting for the next epoch
+    bool exclusive;            // whether the current epoch is an exclusive one
+    size_t exclusive_tickets;  // exclusive epochs ever asked for
+    size_t exclusive_served;   // exclusive epochs ever started
+};
+
+/** Epoch-end work, run by the last transaction leaving an epoch while no
+ * transaction is inside the batcher.
+ * @param arg Opaque argument given to batcher_leave
+**/
+typedef void (*batcher_epoch_end_t)(void* arg);
+
+/** Initialize the given batcher.
+ * @param batcher Batcher to initialize
+ * @return Whether the operation is a success
+**/
+bool batcher_init(struct batcher_t* batcher);
+
+/** Clean up the given batcher.
+ * @param batcher Batcher to clean up
+**/
+void batcher_cleanup(struct batcher_t* batcher);
+
+/** Return the current epoch number.
+ * @param batcher Batcher to query
+ * @return Current epoch
+**/
+size_t batcher_get_epoch(struct batcher_t* batcher);
+
+/** Wait for (and enter) an epoch.
+ * @param batcher Batcher to enter
+ * @return Whether the operation is a success
+**/
+bool batcher_enter(struct batcher_t* batcher);
+
+/** Wait for (and enter) an epoch of one's own.
+ * @param batcher Batcher to enter
+ * @return Whether the operation is a success
+**/
+bool batcher_enter_exclusive(struct batcher_t* batcher);
+
+/** Leave the current epoch; the last one to leave runs the epoch-end work
+ * before the next epoch starts.
+ * @param batcher Batcher to leave
+ * @param on_end  Epoch-end work (can be NULL)
+ * @param arg     Argument for the epoch-end work
+**/
+void batcher_leave(struct batcher_t* batcher, batcher_epoch_end_t on_end, void* arg);
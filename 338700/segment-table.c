@@ -0,0 +1,105 @@
+#include <stdlib.h>
+
+#include "segment-table.h"
+
+// the free-id stack's top packs a tag, bumped on every update, with an id
+static const uint64_t FREE_ID_MASK = ((uint64_t) 1 << 32) - 1;
+static const int FREE_TAG_SHIFT = 32;
+
+bool segment_table_init(struct segment_table_t* table) {
+    for (size_t i = 0; i < SEGMENT_TABLE_MAX_CHUNKS; i++)
+        atomic_init(&table->chunks[i], NULL);
+    atomic_init(&table->next_id, 1);
+    atomic_init(&table->free_head, 0);
+    return true;
+}
+
+void segment_table_cleanup(struct segment_table_t* table) {
+    for (size_t i = 0; i < SEGMENT_TABLE_MAX_CHUNKS; i++)
+        free(atomic_load(&table->chunks[i]));
+}
+
+/** Get the chunk of an id, allocating it on first use.
+ * @param table Table to query
+ * @param id    Id of the chunk
+ * @return Chunk of the id, NULL on allocation failure
+**/
+static struct segment_table_chunk_t* get_chunk(struct segment_table_t* table, uint64_t id) {
+    _Atomic(struct segment_table_chunk_t*)* slot = &table->chunks[id / SEGMENT_TABLE_CHUNK_SIZE];
+    struct segment_table_chunk_t* chunk = atomic_load(slot);
+    if (chunk)
+        return chunk;
+    struct segment_table_chunk_t* fresh = calloc(1, sizeof(struct segment_table_chunk_t));
+    if (!fresh)
+        return NULL;
+    if (!atomic_compare_exchange_strong(slot, &chunk, fresh)) { // someone else was faster
+        free(fresh);
+        return chunk;
+    }
+    return fresh;
+}
+
+/** Pop a recycled id from the free-id stack.
+ * @param table Table to pop from
+ * @return Recycled id, 0 if none
+**/
+static uint64_t pop_free_id(struct segment_table_t* table) {
+    uint64_t head = atomic_load(&table->free_head);
+    while (true) {
+        uint64_t id = head & FREE_ID_MASK;
+        if (id == 0)
+            return 0;
+        struct segment_table_chunk_t* chunk = atomic_load(&table->chunks[id / SEGMENT_TABLE_CHUNK_SIZE]);
+        uint64_t next = atomic_load(&chunk->next_free[id % SEGMENT_TABLE_CHUNK_SIZE]);
+        uint64_t tag = (head >> FREE_TAG_SHIFT) + 1;
+        if (atomic_compare_exchange_weak(&table->free_head, &head, (tag << FREE_TAG_SHIFT) | next))
+            return id;
+    }
+}
+
+uint64_t segment_table_insert(struct segment_table_t* table, void* entry) {
+    uint64_t id = pop_free_id(table);
+    if (id == 0) { // no id to recycle, hand out a new one
+        id = atomic_fetch_add(&table->next_id, 1);
+        if (id >= SEGMENT_TABLE_MAX_IDS)
+            return 0;
+    }
+    struct segment_table_chunk_t* chunk = get_chunk(table, id);
+    if (!chunk)
+        return 0;
+    atomic_store_explicit(&chunk->entries[id % SEGMENT_TABLE_CHUNK_SIZE], entry, memory_order_release);
+    return id;
+}
+
+bool segment_table_insert_at(struct segment_table_t* table, uint64_t id, void* entry) {
+    uint64_t next_id = atomic_load(&table->next_id);
+    if (id < next_id || id >= SEGMENT_TABLE_MAX_IDS)
+        return false;
+    struct segment_table_chunk_t* chunk = get_chunk(table, id);
+    if (!chunk)
+        return false;
+    for (uint64_t skipped = next_id; skipped < id; skipped++) {
+        if (!get_chunk(table, skipped))
+            return false;
+        atomic_store(&table->next_id, skipped + 1);
+        segment_table_remove(table, skipped); // onto the free-id stack
+    }
+    atomic_store_explicit(&chunk->entries[id % SEGMENT_TABLE_CHUNK_SIZE], entry, memory_order_release);
+    atomic_store(&table->next_id, id + 1);
+    return true;
+}
+
+void segment_table_remove(struct segment_table_t* table, uint64_t id) {
+    struct segment_table_chunk_t* chunk = atomic_load(&table->chunks[id / SEGMENT_TABLE_CHUNK_SIZE]);
+    atomic_store(&chunk->entries[id % SEGMENT_TABLE_CHUNK_SIZE], NULL);
+    uint64_t head = atomic_load(&table->free_head);
+    do {
+        atomic_store(&chunk->next_free[id % SEGMENT_TABLE_CHUNK_SIZE], head & FREE_ID_MASK);
+    } while (!atomic_compare_exchange_weak(&table->free_head, &head,
+        (((head >> FREE_TAG_SHIFT) + 1) << FREE_TAG_SHIFT) | id));
+}
+
+uint64_t segment_table_bound(struct segment_table_t* table) {
+    uint64_t bound = atomic_load(&table->next_id);
+    return bound < SEGMENT_TABLE_MAX_IDS ? bound : SEGMENT_TABLE_MAX_IDS;
+}
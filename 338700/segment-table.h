@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// number of entries per chunk, and maximal number of chunks of a table: ids
+// span the 24 bits left by the 40-bit offsets of tagged addresses (see tm.c),
+// i.e. a table holds at most 2^24 - 1 segments (live, pooled or retired)
+#define SEGMENT_TABLE_CHUNK_SIZE ((size_t) 1 << 12)
+#define SEGMENT_TABLE_MAX_CHUNKS ((size_t) 1 << 12)
+// ids are in [1, SEGMENT_TABLE_MAX_IDS), 0 is never handed out
+#define SEGMENT_TABLE_MAX_IDS (SEGMENT_TABLE_CHUNK_SIZE * SEGMENT_TABLE_MAX_CHUNKS)
+
+/**
+ * @brief One chunk of entries, with the links of the free-id stack.
+ */
+struct segment_table_chunk_t {
+    _Atomic(void*) entries[SEGMENT_TABLE_CHUNK_SIZE];
+    _Atomic(uint64_t) next_free[SEGMENT_TABLE_CHUNK_SIZE];
+};
+
+/**
+ * @brief A lock-free table mapping small integer ids to segments. It grows by
+ * chunks allocated on first use, and freed ids are recycled through a
+ * (tagged, so ABA-free) stack.
+ */
+struct segment_table_t {
+    _Atomic(struct segment_table_chunk_t*) chunks[SEGMENT_TABLE_MAX_CHUNKS];
+    _Atomic(uint64_t) next_id;    // first id never handed out
+    _Atomic(uint64_t) free_head;  // top of the free-id stack: tag << 32 | id
+};
+
+/** Initialize the given table.
+ * @param table Table to initialize
+ * @return Whether the operation is a success
+**/
+bool segment_table_init(struct segment_table_t* table);
+
+/** Clean up the given table (not the entries it still holds).
+ * @param table Table to clean up
+**/
+void segment_table_cleanup(struct segment_table_t* table);
+
+/** [thread-safe] Insert an entry, under a recycled id if any.
+ * @param table Table to insert into
+ * @param entry Non-null entry to insert
+ * @return Id of the entry, 0 on failure
+**/
+uint64_t segment_table_insert(struct segment_table_t* table, void* entry);
+
+/** Insert an entry under the given id, in a table being rebuilt (no
+ *  concurrent call). Ids must come in increasing order: the ones skipped are
+ *  handed out again later.
+ * @param table Table to insert into
+ * @param id    Id of the entry, above every id handed out so far
+ * @param entry Non-null entry to insert
+ * @return Whether the operation is a success
+**/
+bool segment_table_insert_at(struct segment_table_t* table, uint64_t id, void* entry);
+
+/** [thread-safe] Remove an entry, its id can then be handed out again.
+ * @param table Table to remove from
+ * @param id    Id of the entry to remove
+**/
+void segment_table_remove(struct segment_table_t* table, uint64_t id);
+
+/** [thread-safe] Return one past the highest id ever handed out.
+ * @param table Table to query
+ * @return Bound on the ids
+**/
+uint64_t segment_table_bound(struct segment_table_t* table);
+
+/** [thread-safe] Get the entry of an id.
+ * @param table Table to query
+ * @param id    Id below the table's bound
+ * @return Entry of the id, NULL if none
+**/
+static inline void* segment_table_get(struct segment_table_t* table, uint64_t id) {
+    struct segment_table_chunk_t* chunk = atomic_load_explicit(
+        &table->chunks[id / SEGMENT_TABLE_CHUNK_SIZE], memory_order_acquire);
+    if (!chunk) // id burned by a failed chunk allocation
+        return NULL;
+    return atomic_load_explicit(&chunk->entries[id % SEGMENT_TABLE_CHUNK_SIZE],
+        memory_order_acquire);
+}
@@ -1,25 +1,74 @@
+#include <sched.h>
+#include <stdint.h>
+
 #include "shared-lock.h"
 
+// number of spins before yielding the processor, while waiting
+#define SHARED_LOCK_SPINS 64
+
+// source of the slot (modulo SHARED_LOCK_SLOTS) of each thread, fixed for its
+// lifetime so that a reader always releases the slot it acquired
+static atomic_size_t slots_counter = 0;
+static _Thread_local size_t thread_slot = SIZE_MAX;
+
+static size_t get_slot(void) {
+    if (thread_slot == SIZE_MAX)
+        thread_slot = atomic_fetch_add_explicit(&slots_counter, 1,
+            memory_order_relaxed) % SHARED_LOCK_SLOTS;
+    return thread_slot;
+}
+
+static void relax(size_t* spins) {
+    if (++*spins < SHARED_LOCK_SPINS)
+        return;
+    *spins = 0;
+    sched_yield();
+}
+
 bool shared_lock_init(struct shared_lock_t* lock) {
-    return pthread_rwlock_init(&lock->rwlock, NULL) == 0;
+    for (size_t i = 0; i < SHARED_LOCK_SLOTS; i++)
+        atomic_init(&lock->slots[i].readers, 0);
+    atomic_init(&lock->writer, false);
+    return pthread_mutex_init(&lock->writers, NULL) == 0;
 }
 
 void shared_lock_cleanup(struct shared_lock_t* lock) {
-    pthread_rwlock_destroy(&lock->rwlock);
+    pthread_mutex_destroy(&lock->writers);
 }
 
 bool shared_lock_acquire(struct shared_lock_t* lock) {
-    return pthread_rwlock_wrlock(&lock->rwlock) == 0;
+    if (pthread_mutex_lock(&lock->writers) != 0)
+        return false;
+    // no new reader gets in from now on, wait for the ones in
+    atomic_store(&lock->writer, true);
+    for (size_t i = 0; i < SHARED_LOCK_SLOTS; i++) {
+        size_t spins = 0;
+        while (atomic_load(&lock->slots[i].readers) != 0)
+            relax(&spins);
+    }
+    return true;
 }
 
 void shared_lock_release(struct shared_lock_t* lock) {
-    pthread_rwlock_unlock(&lock->rwlock);
+    atomic_store(&lock->writer, false);
+    pthread_mutex_unlock(&lock->writers);
 }
 
 bool shared_lock_acquire_shared(struct shared_lock_t* lock) {
-    return pthread_rwlock_rdlock(&lock->rwlock) == 0;
+    atomic_size_t* readers = &lock->slots[get_slot()].readers;
+    size_t spins = 0;
+    while (true) {
+        while (atomic_load(&lock->writer))
+            relax(&spins);
+        atomic_fetch_add(readers, 1);
+        // the writer either sees us, or we see it
+        if (!atomic_load(&lock->writer))
+            return true;
+        atomic_fetch_sub(readers, 1); // let it in first
+    }
 }
 
 void shared_lock_release_shared(struct shared_lock_t* lock) {
-    pthread_rwlock_unlock(&lock->rwlock);
+    atomic_fetch_sub_explicit(&lock->slots[get_slot()].readers, 1,
+        memory_order_release);
 }
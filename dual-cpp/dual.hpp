@@ -0,0 +1,611 @@
+/**
+ * @file   dual.hpp
+ * @author [...]
+ *
+ * @section LICENSE
+ *
+ * [...]
+ *
+ * @section DESCRIPTION
+ *
+ * Header-only dual-versioned transactional memory (C++17 version): the same
+ * design as the C engine in '338700/' (an epoch batcher, two copies of every
+ * word and one packed control word), written once over the word size so that
+ * every read/write loop is specialized, and inlined, for each alignment.
+**/
+
+#pragma once
+
+// External headers
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Internal headers
+#include <tm.hpp>
+#include "macros.h"
+
+// -------------------------------------------------------------------------- //
+
+namespace Dual {
+
+/** Size of a cache line: small slots never straddle two of them, and metadata written by some threads while read by others is padded to it.
+**/
+constexpr static size_t cache_line_size = 64;
+
+/** Largest supported alignment (one instance of the engine per power of 2 up to it).
+**/
+constexpr static size_t max_alignment = 64;
+
+/** Control word of a word, packed so that every access set check/update is a single atomic operation:
+ * - bit 0: copy B is the readable (valid) one, copy A otherwise
+ * - bit 1: word written (in its writable copy) in the current epoch
+ * - bit 2: word accessed by more than one read-write transaction
+ * - bits 3-63: 1st read-write transaction that read/wrote this word (descriptor id, 0 for none)
+ * The all-zero word is a fresh one: copy A valid, neither written nor accessed.
+**/
+namespace Control {
+    constexpr static uint_fast64_t b_valid = 1 << 0;
+    constexpr static uint_fast64_t written = 1 << 1;
+    constexpr static uint_fast64_t shared = 1 << 2;
+    constexpr static int accessor_shift = 3;
+    /** Get the 1st read-write transaction that accessed the word.
+     * @param control Value of the control word
+     * @return Descriptor id, 0 for none
+    **/
+    constexpr static uint_fast64_t accessor(uint_fast64_t control) noexcept {
+        return control >> accessor_shift;
+    }
+}
+
+/** Round up to a power of 2.
+ * @param n Positive number
+ * @return Smallest power of 2 at least 'n'
+**/
+constexpr static size_t ceil_pow2(size_t n) noexcept {
+    size_t res = 1;
+    while (res < n)
+        res *= 2;
+    return res;
+}
+
+/** One word of the given size, copied as a whole.
+**/
+template<size_t Align> struct alignas(Align) Word final {
+    unsigned char bytes[Align];
+};
+
+/** Alignment of a slot, so that a slot (smaller than a line) never straddles two lines.
+**/
+template<size_t Align> constexpr static size_t slot_align = ::std::max({Align, alignof(::std::atomic<uint64_t>), ::std::min(ceil_pow2(2 * Align + sizeof(::std::atomic<uint64_t>)), cache_line_size)});
+
+/** Slot of a word, both copies interleaved with the control word so that accessing a word touches a single line.
+**/
+template<size_t Align> struct alignas(slot_align<Align>) Slot final {
+    Word<Align> copies[2]; // Copy A, copy B
+    ::std::atomic<uint64_t> control;
+};
+
+// Addresses handed out are opaque tagged addresses: the high bits hold the id of the segment (in the segment table), the low bits the offset (in bytes) in the segment. Ids start at 1 so that no address is ever null.
+// The 40-bit offsets bound segments to 1 TiB, and leave 24 bits of ids.
+constexpr static int address_segment_shift = 40;
+constexpr static uint64_t address_offset_mask = (uint64_t(1) << address_segment_shift) - 1;
+
+/** Segment of a region, owning its (zeroed, fresh) slots.
+**/
+template<size_t Align> class Segment final {
+public:
+    uint64_t const id;   // Id in the segment table
+    size_t const size;   // Size (in bytes)
+    ::std::unique_ptr<Slot<Align>[]> const slots;
+public:
+    /** Allocation constructor.
+     * @param id   Id of the segment
+     * @param size Size of the segment (in bytes), a positive multiple of the alignment
+    **/
+    Segment(uint64_t id, size_t size): id{id}, size{size}, slots{new Slot<Align>[size / Align]()} {}
+    /** Get the (tagged) address of a byte of the segment.
+     * @param offset Offset of the byte (in bytes)
+     * @return Opaque shared memory address
+    **/
+    void* address(size_t offset = 0) const noexcept {
+        return reinterpret_cast<void*>(static_cast<uintptr_t>((id << address_segment_shift) | offset));
+    }
+};
+
+/** Read-write transaction descriptor, one per (thread, region), reused by each transaction of its thread.
+**/
+template<size_t Align> struct alignas(cache_line_size) Descriptor final {
+    uint64_t const id; // Accessor id in the control words (unique in its region)
+    ::std::thread::id const owner; // Thread running the transactions
+    bool committed = false;
+    ::std::vector<::std::atomic<uint64_t>*> accessed; // Control words this transaction is the 1st accessor of
+    ::std::vector<Segment<Align>*> allocated; // Segments allocated (released at the epoch end on abort)
+    ::std::vector<Segment<Align>*> freed;     // Segments freed (released at the epoch end on commit)
+    Descriptor* next = nullptr; // Next transaction that left the current epoch
+    /** Id constructor.
+     * @param id Accessor id of the descriptor
+    **/
+    Descriptor(uint64_t id): id{id}, owner{::std::this_thread::get_id()} {}
+};
+
+/** Batcher, grouping transactions into epochs: a transaction entering while an epoch runs waits for the next one, and the last transaction to leave an epoch runs the epoch-end work before letting the waiting ones in.
+**/
+class Batcher final {
+private:
+    ::std::mutex lock;
+    ::std::condition_variable cv;
+    uint_fast64_t epoch = 0;   // Current epoch number
+    size_t remaining = 0;      // Transactions still inside the current epoch
+    size_t blocked = 0;        // Transactions waiting for the next epoch
+public:
+    /** Wait for (and enter) an epoch.
+    **/
+    void enter() {
+        ::std::unique_lock<::std::mutex> guard{lock};
+        if (remaining == 0) { // No running epoch, start one right away
+            remaining = 1;
+            return;
+        }
+        auto current = epoch;
+        ++blocked;
+        cv.wait(guard, [&]() { return epoch != current; });
+    }
+    /** Leave the current epoch, the last one out running the given epoch-end work (while no transaction is inside).
+     * @param on_end Epoch-end work
+    **/
+    template<class Func> void leave(Func&& on_end) {
+        ::std::unique_lock<::std::mutex> guard{lock};
+        if (--remaining > 0)
+            return;
+        on_end();
+        remaining = blocked;
+        blocked = 0;
+        ++epoch;
+        cv.notify_all();
+    }
+};
+
+/** Shared memory region interface, behind the opaque 'shared_t' handle.
+**/
+class Region {
+protected:
+    /** Handle of read-only transactions, which have no descriptor (descriptors being aligned heap objects, none has this address).
+    **/
+    constexpr static tx_t read_only_tx = 1;
+    /** Source of unique region ids (never reused, as region addresses can be).
+    **/
+    static inline ::std::atomic<uint64_t> regions_counter{1};
+    /** Read-write descriptor the calling thread last used, by region id.
+    **/
+    static inline thread_local uint64_t cached_region = 0;
+    static inline thread_local void* cached_descriptor = nullptr;
+    /** Consecutive aborts of the calling thread's transactions (for the backoff).
+    **/
+    static inline thread_local unsigned aborts = 0;
+public:
+    virtual ~Region() = default;
+public:
+    virtual void* start() const noexcept = 0;
+    virtual size_t size() const noexcept = 0;
+    virtual size_t align() const noexcept = 0;
+    virtual tx_t begin(bool) noexcept = 0;
+    virtual bool end(tx_t) noexcept = 0;
+    virtual bool read(tx_t, void const*, size_t, void*) noexcept = 0;
+    virtual bool write(tx_t, void const*, size_t, void*) noexcept = 0;
+    virtual Alloc alloc(tx_t, size_t, void**) noexcept = 0;
+    virtual bool free(tx_t, void*) noexcept = 0;
+};
+
+/** Shared memory region, for words of the given size.
+**/
+template<size_t Align> class RegionOf final: public Region {
+private:
+    using Segment    = Dual::Segment<Align>;
+    using Slot       = Dual::Slot<Align>;
+    using Descriptor = Dual::Descriptor<Align>;
+    /** Segment table, by chunks allocated on first use (reads are lock-free, id changes are locked), spanning the 24 bits of ids: at most 2^24 - 1 segments.
+    **/
+    constexpr static size_t chunk_size = 1 << 12;
+    constexpr static size_t max_chunks = 1 << 12;
+    static_assert(chunk_size * max_chunks <= uint64_t(1) << (64 - address_segment_shift), "Segment ids must fit in tagged addresses");
+    using Chunk = ::std::array<::std::atomic<Segment*>, chunk_size>;
+    /** Backoff of an aborted transaction before it retries.
+    **/
+    constexpr static unsigned backoff_max_shift = 10;
+    constexpr static uint_fast64_t backoff_base_spins = 16;
+private:
+    uint64_t const uid; // Unique id of the region (for the descriptor caches)
+    Segment* first;     // Non-free-able segment
+    ::std::array<::std::atomic<Chunk*>, max_chunks> chunks{};
+    ::std::mutex segments_lock;    // Guards the ids and the chunk allocations
+    uint64_t next_id = 1;          // First id never handed out
+    ::std::vector<uint64_t> free_ids; // Ids to hand out again
+    ::std::mutex descriptors_lock; // Guards the descriptors
+    ::std::vector<::std::unique_ptr<Descriptor>> descriptors;
+    alignas(cache_line_size) Batcher batcher;
+    alignas(cache_line_size) ::std::atomic<Descriptor*> left{nullptr}; // Read-write transactions that left the current epoch
+private:
+    /** Register a new segment under a free id.
+     * @param size Size of the segment (in bytes)
+     * @return Registered segment, null if out of ids or too large (its allocation may throw 'std::bad_alloc')
+    **/
+    Segment* segment_create(size_t size) {
+        if (unlikely(size > address_offset_mask)) // Some offsets would not fit in a tagged address
+            return nullptr;
+        ::std::unique_lock<::std::mutex> guard{segments_lock};
+        uint64_t id;
+        if (!free_ids.empty()) {
+            id = free_ids.back();
+        } else {
+            id = next_id;
+            if (unlikely(id >= chunk_size * max_chunks))
+                return nullptr;
+            auto& chunk = chunks[id / chunk_size];
+            if (!chunk.load(::std::memory_order_relaxed))
+                chunk.store(new Chunk{}, ::std::memory_order_release);
+        }
+        auto segment = new Segment{id, size};
+        if (!free_ids.empty()) {
+            free_ids.pop_back();
+        } else {
+            ++next_id;
+        }
+        (*chunks[id / chunk_size].load(::std::memory_order_relaxed))[id % chunk_size].store(segment, ::std::memory_order_release);
+        return segment;
+    }
+    /** Unregister and delete a segment no transaction can reach anymore.
+     * @param segment Segment to release
+    **/
+    void segment_release(Segment* segment) noexcept {
+        ::std::unique_lock<::std::mutex> guard{segments_lock};
+        auto id = segment->id;
+        (*chunks[id / chunk_size].load(::std::memory_order_relaxed))[id % chunk_size].store(nullptr, ::std::memory_order_relaxed);
+        try {
+            free_ids.push_back(id);
+        } catch (...) { // The id is lost, not the segment
+        }
+        delete segment;
+    }
+    /** Get the segment of a tagged address.
+     * @param address Opaque shared memory address
+     * @return Segment holding the address
+    **/
+    Segment* segment_of(void const* address) const noexcept {
+        auto id = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address)) >> address_segment_shift;
+        return (*chunks[id / chunk_size].load(::std::memory_order_acquire))[id % chunk_size].load(::std::memory_order_acquire);
+    }
+    /** Get the slot of the word at a tagged address.
+     * @param address Opaque shared memory address
+     * @return Slot of the word
+    **/
+    Slot* slot_of(void const* address) const noexcept {
+        auto offset = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address)) & address_offset_mask;
+        return segment_of(address)->slots.get() + offset / Align;
+    }
+    /** Get the calling thread's descriptor of the region, registering one on its first read-write transaction.
+     * @return Descriptor (its registration may throw 'std::bad_alloc')
+    **/
+    Descriptor* get_descriptor() {
+        if (likely(cached_region == uid))
+            return static_cast<Descriptor*>(cached_descriptor);
+        ::std::unique_lock<::std::mutex> guard{descriptors_lock};
+        auto self = ::std::this_thread::get_id();
+        Descriptor* descriptor = nullptr;
+        for (auto& known: descriptors) { // Thread alternating between regions
+            if (known->owner == self) {
+                descriptor = known.get();
+                break;
+            }
+        }
+        if (!descriptor) {
+            descriptors.push_back(::std::make_unique<Descriptor>(descriptors.size() + 1));
+            descriptor = descriptors.back().get();
+        }
+        cached_region = uid;
+        cached_descriptor = descriptor;
+        return descriptor;
+    }
+    /** Epoch-end work, run by the last transaction leaving the batcher: make the writes of committed transactions readable, reset the control word of every accessed word, release the segments freed (resp. allocated) by committed (resp. aborted) transactions and empty the descriptors of left transactions.
+    **/
+    void end_epoch() noexcept {
+        auto transaction = left.exchange(nullptr);
+        for (auto it = transaction; it; it = it->next) {
+            for (auto word: it->accessed) {
+                auto control = word->load(::std::memory_order_relaxed);
+                auto valid = control & Control::b_valid;
+                if (it->committed && (control & Control::written))
+                    valid ^= Control::b_valid; // Writable copy becomes readable
+                word->store(valid, ::std::memory_order_relaxed);
+            }
+        }
+        // Only once every accessed word is reset (some may belong to the segments released below)
+        while (transaction) {
+            auto next = transaction->next;
+            for (auto segment: transaction->committed ? transaction->freed : transaction->allocated)
+                segment_release(segment);
+            transaction->accessed.clear();
+            transaction->allocated.clear();
+            transaction->freed.clear();
+            transaction = next;
+        }
+    }
+    /** Leave the batcher with the given read-write transaction, once it either committed or aborted.
+     * @param transaction Read-write transaction leaving
+     * @param committed   Whether the transaction committed
+    **/
+    void leave(Descriptor* transaction, bool committed) noexcept {
+        aborts = committed ? 0 : aborts + 1;
+        transaction->committed = committed;
+        transaction->next = left.load(::std::memory_order_relaxed);
+        while (!left.compare_exchange_weak(transaction->next, transaction));
+        batcher.leave([&]() { end_epoch(); });
+    }
+    /** Back off before retrying an aborted transaction, for a random time exponentially longer with each consecutive abort.
+    **/
+    static void backoff() noexcept {
+        static thread_local uint_fast64_t seed = 0;
+        if (unlikely(seed == 0))
+            seed = reinterpret_cast<uintptr_t>(&seed) | 1;
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        auto shift = ::std::min(aborts, backoff_max_shift);
+        auto spins = seed & ((backoff_base_spins << shift) - 1);
+        for (uint_fast64_t i = 0; i < spins; ++i) {
+#if defined(__i386__) || defined(__x86_64__)
+            __builtin_ia32_pause();
+#endif
+        }
+    }
+    /** Make room in a vector for one more element, growing it geometrically (so that filling it stays linear).
+     * @param vector Vector to grow (if full), may throw 'std::bad_alloc'
+    **/
+    template<class Vector> static void reserve_one(Vector& vector) {
+        if (vector.size() == vector.capacity())
+            vector.reserve(::std::max(vector.capacity() * 2, size_t(16)));
+    }
+    /** Make room in an access set for one more word.
+     * @param transaction Read-write transaction
+     * @return Whether there is room
+    **/
+    static bool reserve_access(Descriptor* transaction) noexcept {
+        auto& accessed = transaction->accessed;
+        if (likely(accessed.size() < accessed.capacity()))
+            return true;
+        try {
+            reserve_one(accessed);
+        } catch (...) {
+            return false;
+        }
+        return true;
+    }
+    /** Read a word in a read-write transaction, joining its access set.
+     * @param slot        Slot of the word
+     * @param target      Target word (in a private region)
+     * @param transaction Read-write transaction
+     * @return Whether the whole transaction can continue
+    **/
+    static bool read_word(Slot& slot, unsigned char* target, Descriptor* transaction) noexcept {
+        auto control = slot.control.load(::std::memory_order_relaxed);
+        while (true) {
+            auto accessor = Control::accessor(control);
+            bool b_valid = control & Control::b_valid;
+            if (control & Control::written) {
+                if (accessor != transaction->id)
+                    return false; // Written by another transaction
+                ::std::memcpy(target, &slot.copies[!b_valid], Align);
+                return true;
+            }
+            if (accessor == transaction->id || (control & Control::shared)) { // Already in the access set
+                ::std::memcpy(target, &slot.copies[b_valid], Align);
+                return true;
+            }
+            uint_fast64_t desired;
+            if (accessor == 0) { // Neither written nor read: claim it
+                if (unlikely(!reserve_access(transaction)))
+                    return false;
+                desired = control | (transaction->id << Control::accessor_shift);
+            } else { // Read by another transaction: no one can write it anymore
+                desired = control | Control::shared;
+            }
+            if (slot.control.compare_exchange_weak(control, desired, ::std::memory_order_relaxed)) {
+                if (accessor == 0)
+                    transaction->accessed.push_back(&slot.control);
+                ::std::memcpy(target, &slot.copies[b_valid], Align);
+                return true;
+            }
+        }
+    }
+    /** Write a word in a read-write transaction, claiming it.
+     * @param slot        Slot of the word
+     * @param source      Source word (in a private region)
+     * @param transaction Read-write transaction
+     * @return Whether the whole transaction can continue
+    **/
+    static bool write_word(Slot& slot, unsigned char const* source, Descriptor* transaction) noexcept {
+        auto control = slot.control.load(::std::memory_order_relaxed);
+        while (true) {
+            auto accessor = Control::accessor(control);
+            bool b_valid = control & Control::b_valid;
+            if (control & Control::written) {
+                if (accessor != transaction->id)
+                    return false; // Written by another transaction
+                ::std::memcpy(&slot.copies[!b_valid], source, Align);
+                return true;
+            }
+            if ((control & Control::shared) || (accessor != 0 && accessor != transaction->id))
+                return false; // Read by another transaction
+            if (accessor == 0 && unlikely(!reserve_access(transaction)))
+                return false;
+            auto desired = control | Control::written | (transaction->id << Control::accessor_shift);
+            if (slot.control.compare_exchange_weak(control, desired, ::std::memory_order_relaxed)) {
+                if (accessor == 0)
+                    transaction->accessed.push_back(&slot.control);
+                ::std::memcpy(&slot.copies[!b_valid], source, Align);
+                return true;
+            }
+        }
+    }
+public:
+    /** Creation constructor.
+     * @param size Size of the first segment (in bytes), a positive multiple of the alignment
+    **/
+    RegionOf(size_t size): uid{regions_counter.fetch_add(1, ::std::memory_order_relaxed)} {
+        first = segment_create(size);
+        if (unlikely(!first))
+            throw ::std::bad_alloc{};
+    }
+    /** Destructor, with no running transaction.
+    **/
+    ~RegionOf() noexcept {
+        for (auto& chunk: chunks) {
+            auto entries = chunk.load(::std::memory_order_relaxed);
+            if (!entries)
+                continue;
+            for (auto& entry: *entries)
+                delete entry.load(::std::memory_order_relaxed);
+            delete entries;
+        }
+    }
+public:
+    void* start() const noexcept {
+        return first->address();
+    }
+    size_t size() const noexcept {
+        return first->size;
+    }
+    size_t align() const noexcept {
+        return Align;
+    }
+    tx_t begin(bool is_ro) noexcept {
+        if (is_ro) {
+            try {
+                batcher.enter();
+            } catch (...) {
+                return invalid_tx;
+            }
+            return read_only_tx;
+        }
+        Descriptor* transaction;
+        try {
+            transaction = get_descriptor();
+            if (aborts > 0)
+                backoff();
+            batcher.enter();
+        } catch (...) {
+            return invalid_tx;
+        }
+        // Only now the end of the previous transaction's epoch is sure to be done with the descriptor
+        transaction->committed = false;
+        transaction->next = nullptr;
+        return reinterpret_cast<tx_t>(transaction);
+    }
+    bool end(tx_t tx) noexcept {
+        if (tx == read_only_tx) {
+            batcher.leave([&]() { end_epoch(); });
+            return true;
+        }
+        // No conflict detected so far: commit, writes become readable at the end of the epoch
+        leave(reinterpret_cast<Descriptor*>(tx), true);
+        return true;
+    }
+    bool read(tx_t tx, void const* source, size_t size, void* target) noexcept {
+        auto slot = slot_of(source);
+        auto count = size / Align;
+        auto copy = static_cast<unsigned char*>(target);
+        if (tx == read_only_tx) { // Readable copies never change within an epoch
+            for (size_t i = 0; i < count; ++i, copy += Align) {
+                auto control = slot[i].control.load(::std::memory_order_relaxed);
+                ::std::memcpy(copy, &slot[i].copies[control & Control::b_valid], Align);
+            }
+            return true;
+        }
+        auto transaction = reinterpret_cast<Descriptor*>(tx);
+        auto mine = transaction->id << Control::accessor_shift;
+        constexpr auto accessor_mask = ~((uint_fast64_t(1) << Control::accessor_shift) - 1);
+        for (size_t i = 0; i < count; ++i, copy += Align) {
+            auto control = slot[i].control.load(::std::memory_order_relaxed);
+            if ((control & accessor_mask) == mine) { // Accessed by this transaction: the writable copy iff written
+                ::std::memcpy(copy, &slot[i].copies[(control ^ (control >> 1)) & Control::b_valid], Align);
+            } else if (!read_word(slot[i], copy, transaction)) {
+                leave(transaction, false);
+                return false;
+            }
+        }
+        return true;
+    }
+    bool write(tx_t tx, void const* source, size_t size, void* target) noexcept {
+        auto transaction = reinterpret_cast<Descriptor*>(tx);
+        auto slot = slot_of(target);
+        auto count = size / Align;
+        auto copy = static_cast<unsigned char const*>(source);
+        auto mine = Control::written | (transaction->id << Control::accessor_shift);
+        constexpr auto owner_mask = ~((uint_fast64_t(1) << Control::accessor_shift) - 1) | Control::written;
+        for (size_t i = 0; i < count; ++i, copy += Align) {
+            auto control = slot[i].control.load(::std::memory_order_relaxed);
+            if ((control & owner_mask) == mine) { // Already written by this transaction
+                ::std::memcpy(&slot[i].copies[!(control & Control::b_valid)], copy, Align);
+            } else if (!write_word(slot[i], copy, transaction)) {
+                leave(transaction, false);
+                return false;
+            }
+        }
+        return true;
+    }
+    Alloc alloc(tx_t tx, size_t size, void** target) noexcept {
+        auto transaction = reinterpret_cast<Descriptor*>(tx);
+        try {
+            reserve_one(transaction->allocated); // Before creating the segment, so that it is never lost
+            auto segment = segment_create(size);
+            if (unlikely(!segment))
+                return Alloc::nomem;
+            transaction->allocated.push_back(segment); // Released at the end of the epoch if the transaction aborts
+            *target = segment->address();
+        } catch (...) {
+            return Alloc::nomem;
+        }
+        return Alloc::success;
+    }
+    bool free(tx_t tx, void* target) noexcept {
+        auto transaction = reinterpret_cast<Descriptor*>(tx);
+        // The segment may still be accessed by the other transactions of the epoch: it is only released when the last one leaves, and only if this transaction commits
+        try {
+            transaction->freed.push_back(segment_of(target));
+        } catch (...) {
+            leave(transaction, false);
+            return false;
+        }
+        return true;
+    }
+};
+
+/** Create a region for the given alignment.
+ * @param size  Size of the first segment (in bytes)
+ * @param align Alignment of the words (a power of 2)
+ * @return Region, null on failure (or alignment above 'max_alignment')
+**/
+template<size_t Align = 1> Region* make_region(size_t size, size_t align) noexcept {
+    if constexpr (Align > max_alignment) {
+        return nullptr;
+    } else {
+        if (align != Align)
+            return make_region<Align * 2>(size, align);
+        try {
+            return new RegionOf<Align>{size};
+        } catch (...) {
+            return nullptr;
+        }
+    }
+}
+
+}
@@ -24,17 +24,35 @@
 #pragma once
 
 // External headers
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <climits>
 #include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
+#include <fstream>
 #include <mutex>
+#include <sstream>
+#include <string>
 #include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
+#include <vector>
 extern "C" {
+#include <dirent.h>
+#include <linux/futex.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
 #include <time.h>
+#include <unistd.h>
 }
 
 // -------------------------------------------------------------------------- //
@@ -115,6 +133,7 @@ public:
 EXCEPTION(Unreachable, Any, "unreachable code reached");
 EXCEPTION(Bounded, Any, "bounded execution exception");
     EXCEPTION(BoundedOverrun, Any, "bounded execution overrun");
+EXCEPTION(Affinity, Any, "unable to set the affinity of a worker thread");
 
 }
 // -------------------------------------------------------------------------- //
@@ -199,6 +218,198 @@ public:
     }
 };
 
+/** Hardware performance counters of the calling thread, through 'perf_event_open'.
+ * Each event is optional: the ones the kernel or CPU refuses are just not counted.
+**/
+class Counters final {
+public:
+    /** Counted events.
+    **/
+    enum Event: size_t {
+        cycles,       // CPU cycles
+        instructions, // Retired instructions
+        llc_misses,   // Last-level cache misses
+        coherence,    // Model-specific raw event (e.g. HITM loads), only if configured
+        nbevents
+    };
+    /** Get the name of an event.
+     * @param event Event
+     * @return Event name (plural)
+    **/
+    static char const* name(size_t event) noexcept {
+        constexpr static char const* names[nbevents] = {"cycles", "instructions", "LLC misses", "coherence events"};
+        return names[event];
+    }
+    /** Accumulated counts.
+    **/
+    struct Values {
+        uint_fast64_t counts[nbevents] = {}; // Counts, by event
+        bool          valid[nbevents]  = {}; // Whether the event was counted
+        /** Add other counts to these ones.
+         * @param other Counts to merge
+        **/
+        void merge(Values const& other) noexcept {
+            for (size_t i = 0; i < nbevents; ++i) {
+                counts[i] += other.counts[i];
+                valid[i] = valid[i] || other.valid[i];
+            }
+        }
+    };
+    /** Counters setup.
+    **/
+    struct Setup {
+        bool     enabled = false; // Whether to count at all
+        uint64_t raw     = 0;     // Raw 'coherence' event configuration, 0 for none
+    };
+private:
+    int fds[nbevents]; // Event file descriptors, -1 if not counted
+    int leader;        // Group leader file descriptor, -1 if none
+public:
+    /** Deleted copy constructor/assignment.
+    **/
+    Counters(Counters const&) = delete;
+    Counters& operator=(Counters const&) = delete;
+    /** Open the counters of the calling thread, disabled.
+     * @param setup Counters setup
+    **/
+    Counters(Setup const& setup): leader{-1} {
+        uint64_t const configs[nbevents] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, setup.raw};
+        for (size_t i = 0; i < nbevents; ++i) {
+            fds[i] = -1;
+            if (!setup.enabled || (i == coherence && setup.raw == 0))
+                continue;
+            struct ::perf_event_attr attr;
+            ::std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = i == coherence ? PERF_TYPE_RAW : PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = leader < 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds[i] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (leader < 0)
+                leader = fds[i];
+        }
+    }
+    /** Close the counters.
+    **/
+    ~Counters() {
+        for (auto fd: fds) {
+            if (fd >= 0)
+                ::close(fd);
+        }
+    }
+public:
+    /** Reset and start counting.
+    **/
+    void start() noexcept {
+        if (leader < 0)
+            return;
+        ::ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    /** Stop counting, and add the counts since 'start'.
+     * @param values Counts to add to
+    **/
+    void stop(Values& values) noexcept {
+        if (leader < 0)
+            return;
+        ::ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        for (size_t i = 0; i < nbevents; ++i) {
+            uint64_t count;
+            if (fds[i] < 0 || ::read(fds[i], &count, sizeof(count)) != sizeof(count))
+                continue;
+            values.counts[i] += count;
+            values.valid[i] = true;
+        }
+    }
+};
+
+/** Latency histogram class, HDR-style: log-linear buckets, each power of two
+ * split into 'nbsubs' sub-buckets, so that a value is known within ~3%.
+**/
+class Histogram final {
+public:
+    /** Value class (in ticks).
+    **/
+    using Value = Chrono::Tick;
+private:
+    constexpr static auto subbits = 5; // Log2 of the number of sub-buckets per power of two
+    constexpr static auto nbsubs  = size_t{1} << subbits;
+    constexpr static auto nbbuckets = (64 - subbits + 1) * nbsubs; // Covers every 64-bit value
+    ::std::vector<uint_fast64_t> buckets; // Number of values per bucket
+    uint_fast64_t total; // Number of recorded values
+    Value maximum; // Maximum recorded value
+private:
+    /** Get the bucket of a value.
+     * @param value Value to bucket
+     * @return Bucket index
+    **/
+    static size_t bucket_of(Value value) noexcept {
+        if (value < nbsubs)
+            return static_cast<size_t>(value);
+        auto exponent = 63 - __builtin_clzll(static_cast<unsigned long long>(value)); // At least 'subbits'
+        return static_cast<size_t>(exponent - subbits + 1) * nbsubs + static_cast<size_t>((value >> (exponent - subbits)) - nbsubs);
+    }
+    /** Get the highest value of a bucket.
+     * @param bucket Bucket index
+     * @return Highest value falling into that bucket
+    **/
+    static Value highest_of(size_t bucket) noexcept {
+        if (bucket < nbsubs)
+            return static_cast<Value>(bucket);
+        auto shift = bucket / nbsubs - 1;
+        auto mantissa = static_cast<Value>(nbsubs + bucket % nbsubs);
+        return ((mantissa + 1) << shift) - 1;
+    }
+public:
+    /** Empty histogram constructor.
+    **/
+    Histogram(): buckets(nbbuckets, 0), total{0}, maximum{0} {}
+public:
+    /** Record one value.
+     * @param value Value to record
+    **/
+    void record(Value value) noexcept {
+        ++buckets[bucket_of(value)];
+        ++total;
+        if (value > maximum)
+            maximum = value;
+    }
+    /** Add the values of another histogram to this one.
+     * @param other Histogram to merge
+    **/
+    void merge(Histogram const& other) noexcept {
+        for (size_t i = 0; i < nbbuckets; ++i)
+            buckets[i] += other.buckets[i];
+        total += other.total;
+        if (other.maximum > maximum)
+            maximum = other.maximum;
+    }
+    /** Get the number of recorded values.
+     * @return Number of recorded values
+    **/
+    auto count() const noexcept {
+        return total;
+    }
+    /** Get the value below which the given fraction of the recorded values lie.
+     * @param fraction Fraction, in [0, 1]
+     * @return Value at that fraction (within the bucket precision), 0 if no value was recorded
+    **/
+    Value percentile(double fraction) const noexcept {
+        auto rank = static_cast<uint_fast64_t>(fraction * static_cast<double>(total) + 0.5);
+        if (rank == 0)
+            rank = 1;
+        uint_fast64_t seen = 0;
+        for (size_t i = 0; i < nbbuckets; ++i) {
+            seen += buckets[i];
+            if (seen >= rank)
+                return ::std::min(highest_of(i), maximum);
+        }
+        return maximum;
+    }
+};
+
 /** Atomic waitable latch class.
 **/
 class Latch final {
@@ -285,23 +496,71 @@ template<class Rep, class Period, class Func> static void bounded_run(::std::chr
     runner.join();
 }
 
-/** Spin barrier class.
+/** Parked (i.e. futex-waiting) threads counter class.
+**/
+using Parked = ::std::atomic<uint_fast32_t>;
+
+// Number of 'short_pause' to spin for before parking
+constexpr static auto park_spins = 256u;
+
+/** Wait until a 32-bit atomic word takes a wanted value: spin for a bounded budget, then park on the word.
+ * @param word   Word to wait on
+ * @param parked Counter of the threads parked on that word
+ * @param done   Whether the value is a wanted one (Type -> bool)
+ * @return Wanted value, loaded with acquire semantic
+**/
+template<class Type, class Pred> static Type park_until(::std::atomic<Type> const& word, Parked& parked, Pred&& done) {
+    static_assert(sizeof(::std::atomic<Type>) == sizeof(uint32_t) && ::std::atomic<Type>::is_always_lock_free, "Futex words are 32-bit wide");
+    for (auto spin = 0u; spin < park_spins; ++spin) {
+        auto value = word.load(::std::memory_order_acquire);
+        if (done(value))
+            return value;
+        short_pause();
+    }
+    parked.fetch_add(1, ::std::memory_order_seq_cst); // Ordered before the next load, pairs with 'wake_parked'
+    while (true) {
+        auto value = word.load(::std::memory_order_seq_cst);
+        if (done(value)) {
+            parked.fetch_sub(1, ::std::memory_order_relaxed);
+            return value;
+        }
+        uint32_t raw;
+        ::std::memcpy(&raw, &value, sizeof(raw));
+        ::syscall(SYS_futex, &word, FUTEX_WAIT_PRIVATE, raw, nullptr, nullptr, 0); // Sleeps only if the word still holds 'value'
+    }
+}
+
+/** Wake every thread parked on a 32-bit atomic word, after it was stored (seq_cst).
+ * @param word   Word the threads are parked on
+ * @param parked Counter of the threads parked on that word
+**/
+template<class Type> static void wake_parked(::std::atomic<Type> const& word, Parked const& parked) {
+    if (parked.load(::std::memory_order_seq_cst) > 0)
+        ::syscall(SYS_futex, &word, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+/** Combining tree barrier class: threads arrive on small groups, the last of each group going up,
+ * and the very last flips a sense-reversing flag, on which the other threads spin then park.
 **/
 class Barrier final {
 public:
     /** Counter class.
     **/
     using Counter = uint_fast32_t;
-    /** Mode enum class.
+private:
+    constexpr static Counter fanin = 4; // Number of children per tree node
+    constexpr static size_t  noparent = SIZE_MAX; // Parent index of the root
+    /** Tree node, on its own cache line.
     **/
-    enum class Mode {
-        enter,
-        leave
+    struct alignas(64) Node {
+        ::std::atomic<Counter> count; // Number of arrived children
+        Counter target;               // Number of children
+        size_t  parent;               // Index of the parent node, 'noparent' for the root
     };
-private:
     Counter cardinal; // Total number of threads that synchronize
-    ::std::atomic<Counter> mutable step; // Step counters
-    ::std::atomic<Mode>    mutable mode; // Current mode
+    ::std::vector<Node> mutable nodes; // Tree nodes, the leaves first
+    alignas(64) ::std::atomic<uint32_t> mutable sense; // Flipped (incremented) by the last thread to arrive
+    Parked mutable parked; // Number of threads parked on 'sense'
 public:
     /** Deleted copy constructor/assignment.
     **/
@@ -310,24 +569,245 @@ public:
     /** Number of threads constructor.
      * @param cardinal Non-null total number of threads synchronizing on this barrier
     **/
-    Barrier(Counter cardinal): cardinal{cardinal}, step{0}, mode{Mode::enter} {}
+    Barrier(Counter cardinal): cardinal{cardinal}, sense{0}, parked{0} {
+        ::std::vector<::std::pair<Counter, size_t>> layout; // Number of children and parent index of each node
+        for (Counter left = cardinal; left > 0; left -= ::std::min(left, fanin))
+            layout.emplace_back(::std::min(left, fanin), noparent);
+        for (size_t first = 0, count = layout.size(); count > 1; count = layout.size() - first) { // One level up, until a single root
+            auto next = layout.size();
+            for (size_t i = 0; i < count; ++i) {
+                if (i % fanin == 0)
+                    layout.emplace_back(0, noparent);
+                ++layout.back().first;
+                layout[first + i].second = next + i / fanin;
+            }
+            first = next;
+        }
+        nodes = ::std::vector<Node>(layout.size());
+        for (size_t i = 0; i < layout.size(); ++i) {
+            nodes[i].count.store(0, ::std::memory_order_relaxed);
+            nodes[i].target = layout[i].first;
+            nodes[i].parent = layout[i].second;
+        }
+    }
 public:
     /** [thread-safe] Synchronize all the threads.
+     * @param id Index of the calling thread, in [0, cardinal)
+    **/
+    void sync(Counter id) const {
+        auto const current = sense.load(::std::memory_order_acquire); // Cannot flip before this thread arrives
+        auto node = static_cast<size_t>(id % cardinal) / fanin;
+        while (true) {
+            auto& arrival = nodes[node];
+            if (arrival.count.fetch_add(1, ::std::memory_order_acq_rel) + 1 < arrival.target) { // Not the last child, wait for the release
+                park_until(sense, parked, [&](uint32_t value) { return value != current; });
+                return;
+            }
+            arrival.count.store(0, ::std::memory_order_relaxed); // Ready for the next episode, published by the release
+            if (arrival.parent == noparent)
+                break;
+            node = arrival.parent;
+        }
+        sense.store(current + 1, ::std::memory_order_seq_cst); // Release every thread
+        wake_parked(sense, parked);
+    }
+};
+
+// -------------------------------------------------------------------------- //
+
+/** Worker thread placement class, from the topology of the CPUs the process may run on.
+**/
+class Placement final {
+public:
+    /** Placement policy.
+    **/
+    enum class Policy {
+        none,    // Let the scheduler place the workers
+        compact, // One CPU per worker, filling each core (hyperthreads first), then each socket, then each NUMA node
+        scatter, // One CPU per worker, spreading the workers over the NUMA nodes, then over the cores, hyperthreads last
+        node     // Workers fill one NUMA node after the other, each free to run on any CPU of its node
+    };
+private:
+    /** Topology of one CPU.
+    **/
+    struct Cpu {
+        int id;      // CPU number
+        int node;    // NUMA node
+        int package; // Physical socket
+        int core;    // Core in the socket
+        int smt;     // Rank among the allowed hyperthreads of the same core
+    };
+    /** Where one worker may run.
+    **/
+    struct Slot {
+        int node; // NUMA node of the CPUs
+        ::std::vector<int> cpus; // Allowed CPUs
+    };
+    Policy policy; // Placement policy
+    ::std::vector<Slot> slots; // Slots, worker i taking slot i modulo their count
+private:
+    /** Read a single integer from a sysfs file.
+     * @param path Path of the file
+     * @param def  Default value, if the file cannot be read
+     * @return Read value
+    **/
+    static int read_int(::std::string const& path, int def) {
+        ::std::ifstream file{path};
+        int res;
+        if (!(file >> res))
+            return def;
+        return res;
+    }
+    /** Get the NUMA node of a CPU, from the 'node<n>' link in its sysfs directory.
+     * @param id CPU number
+     * @return NUMA node (0 if unknown)
+    **/
+    static int node_of(int id) {
+        auto dir = ::opendir(("/sys/devices/system/cpu/cpu" + ::std::to_string(id)).c_str());
+        if (!dir)
+            return 0;
+        auto res = 0;
+        while (auto entry = ::readdir(dir)) {
+            if (::std::strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+                res = ::std::atoi(entry->d_name + 4);
+                break;
+            }
+        }
+        ::closedir(dir);
+        return res;
+    }
+    /** Get the topology of the CPUs the process may run on.
+     * @return Allowed CPUs, by increasing number
+    **/
+    static ::std::vector<Cpu> topology() {
+        ::std::vector<Cpu> res;
+        cpu_set_t allowed;
+        if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+            throw Exception::Affinity{"unable to get the CPUs the process may run on"};
+        for (int id = 0; id < CPU_SETSIZE; ++id) {
+            if (!CPU_ISSET(id, &allowed))
+                continue;
+            auto base = "/sys/devices/system/cpu/cpu" + ::std::to_string(id) + "/topology/";
+            Cpu cpu{id, node_of(id), read_int(base + "physical_package_id", 0), read_int(base + "core_id", id), 0};
+            for (auto const& other: res) {
+                if (other.package == cpu.package && other.core == cpu.core)
+                    ++cpu.smt;
+            }
+            res.push_back(cpu);
+        }
+        return res;
+    }
+    /** Build the slots of the current policy.
     **/
-    void sync() const {
-        // Enter
-        if (step.fetch_add(1, ::std::memory_order_relaxed) + 1 == cardinal) { // Set leave mode
-            mode.store(Mode::leave, ::std::memory_order_release);
-        } else { // Wait for leave mode
-            while (unlikely(mode.load(::std::memory_order_acquire) != Mode::leave))
-                short_pause();
+    void build() {
+        slots.clear();
+        if (policy == Policy::none)
+            return;
+        auto cpus = topology();
+        if (policy == Policy::compact) {
+            ::std::sort(cpus.begin(), cpus.end(), [](Cpu const& a, Cpu const& b) {
+                return ::std::tie(a.node, a.package, a.core, a.smt) < ::std::tie(b.node, b.package, b.core, b.smt);
+            });
+            for (auto const& cpu: cpus)
+                slots.push_back(Slot{cpu.node, {cpu.id}});
+            return;
+        }
+        ::std::sort(cpus.begin(), cpus.end(), [](Cpu const& a, Cpu const& b) {
+            return ::std::tie(a.node, a.smt, a.package, a.core) < ::std::tie(b.node, b.smt, b.package, b.core);
+        });
+        ::std::vector<Slot> nodes; // Allowed CPUs of each (non-empty) node, by increasing node number
+        for (size_t i = 0; i < cpus.size(); ++i) {
+            if (i == 0 || cpus[i].node != cpus[i - 1].node)
+                nodes.push_back(Slot{cpus[i].node, {}});
+            nodes.back().cpus.push_back(cpus[i].id);
         }
-        // Leave
-        if (step.fetch_sub(1, ::std::memory_order_relaxed) - 1 == 0) { // Set enter mode
-            mode.store(Mode::enter, ::std::memory_order_release);
-        } else { // Wait for enter mode
-            while (unlikely(mode.load(::std::memory_order_acquire) != Mode::enter))
-                short_pause();
+        if (policy == Policy::scatter) {
+            for (size_t rank = 0; slots.size() < cpus.size(); ++rank) { // Round-robin over the nodes
+                for (auto const& node: nodes) {
+                    if (rank < node.cpus.size())
+                        slots.push_back(Slot{node.node, {node.cpus[rank]}});
+                }
+            }
+            return;
+        }
+        for (auto const& node: nodes) { // One slot per CPU of the node, each allowing the whole node
+            for (size_t i = 0; i < node.cpus.size(); ++i)
+                slots.push_back(node);
         }
     }
+public:
+    /** No placement constructor.
+    **/
+    Placement(): policy{Policy::none} {}
+public:
+    /** Parse a placement policy, and build its slots.
+     * @param text Policy name, one of 'none', 'compact', 'scatter' or 'node'
+     * @return Whether the name was valid
+    **/
+    bool parse(::std::string const& text) {
+        if (text == "none") {
+            policy = Policy::none;
+        } else if (text == "compact") {
+            policy = Policy::compact;
+        } else if (text == "scatter") {
+            policy = Policy::scatter;
+        } else if (text == "node") {
+            policy = Policy::node;
+        } else {
+            return false;
+        }
+        build();
+        return true;
+    }
+    /** Get the name of the policy.
+     * @return Policy name, as accepted by 'parse'
+    **/
+    char const* name() const noexcept {
+        switch (policy) {
+        case Policy::compact:
+            return "compact";
+        case Policy::scatter:
+            return "scatter";
+        case Policy::node:
+            return "node";
+        default:
+            return "none";
+        }
+    }
+    /** Describe where the given number of workers run.
+     * @param nbworkers Number of workers
+     * @return Policy name, followed by the CPU (and its node), or the node, of each worker
+    **/
+    ::std::string describe(size_t nbworkers) const {
+        ::std::ostringstream res;
+        res << name();
+        if (slots.empty())
+            return res.str();
+        res << " (";
+        for (size_t i = 0; i < nbworkers; ++i) {
+            auto const& slot = slots[i % slots.size()];
+            if (i > 0)
+                res << ", ";
+            if (policy == Policy::node) {
+                res << "node " << slot.node;
+            } else {
+                res << "cpu " << slot.cpus.front() << "@node " << slot.node;
+            }
+        }
+        res << ")";
+        return res.str();
+    }
+    /** Pin the calling thread, throws 'Exception::Affinity' on failure.
+     * @param worker Worker number
+    **/
+    void apply(size_t worker) const {
+        if (slots.empty())
+            return;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto id: slots[worker % slots.size()].cpus)
+            CPU_SET(id, &set);
+        if (::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) != 0)
+            throw Exception::Affinity{};
+    }
 };
@@ -23,11 +23,19 @@
 
 // External headers
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <sstream>
+#include <string>
 #include <variant>
+#include <vector>
 
 // Internal headers
 #include "common.hpp"
@@ -42,7 +50,7 @@ class Sync final {
 private:
     /** Synchronization status.
     **/
-    enum class Status {
+    enum class Status: uint32_t {
         Wait,  // Workers waiting each others, run as soon as all ready
         Run,   // Workers running (still full success)
         Abort, // Workers running (>0 failure)
@@ -54,6 +62,7 @@ private:
     unsigned int const        nbworkers; // Number of workers to support
     ::std::atomic<unsigned int> nbready; // Number of thread having reached that state
     ::std::atomic<Status>       status;  // Current synchronization status
+    Parked                      parked;  // Number of workers parked on 'status'
     ::std::atomic<char const*>  errmsg;  // Any one of the error message(s)
     Chrono                      runtime; // Runtime between 'master_notify' and when the last worker finished
     Latch                     donelatch; // For synchronization last worker -> master
@@ -65,18 +74,21 @@ public:
     /** Worker count constructor.
      * @param nbworkers Number of workers to support
     **/
-    Sync(unsigned int nbworkers): nbworkers{nbworkers}, nbready{0}, status{Status::Done}, errmsg{nullptr} {}
+    Sync(unsigned int nbworkers): nbworkers{nbworkers}, nbready{0}, status{Status::Done}, parked{0}, errmsg{nullptr} {}
 public:
     /** Master trigger "synchronized" execution in all threads (instead of joining).
     **/
     void master_notify() noexcept {
-        status.store(Status::Wait, ::std::memory_order_relaxed);
+        runtime.reset(); // Each step is timed on its own
         runtime.start();
+        status.store(Status::Wait, ::std::memory_order_seq_cst); // Synchronize-with workers waiting for the wait state
+        wake_parked(status, parked);
     }
     /** Master trigger termination in all threads (instead of notifying).
     **/
     void master_join() noexcept {
-        status.store(Status::Quit, ::std::memory_order_relaxed);
+        status.store(Status::Quit, ::std::memory_order_seq_cst);
+        wake_parked(status, parked);
     }
     /** Master wait for all workers to finish.
      * @param maxtick Maximum number of ticks to wait before exiting the process on an error (optional, 'invalid_tick' for none)
@@ -96,28 +108,25 @@ public:
             throw Exception::Unreachable{"Master woke after raised latch, no timeout, but unexpected status"};
         }
     }
-    /** Worker spin-wait until next run.
+    /** Worker wait (spin, then park) until next run.
      * @return Whether the worker can proceed, or quit otherwise
     **/
     bool worker_wait() noexcept {
-        while (true) {
-            auto res = status.load(::std::memory_order_relaxed);
-            if (res == Status::Wait)
-                break;
-            if (res == Status::Quit)
-                return false;
-            short_pause();
-        }
+        auto next = park_until(status, parked, [](Status res) { // Synchronize-with the master switching to wait/quit state
+            return res == Status::Wait || res == Status::Quit;
+        });
+        if (next == Status::Quit)
+            return false;
         auto res = nbready.fetch_add(1, ::std::memory_order_relaxed);
         if (res + 1 == nbworkers) { // Latest worker, switch to run status
             nbready.store(0, ::std::memory_order_relaxed);
-            status.store(Status::Run, ::std::memory_order_release); // Synchronize-with previous worker waiting for run/abort state
-        } else do { // Not latest worker, wait for run status
-            short_pause();
-            auto res = status.load(::std::memory_order_acquire); // Synchronize-with latest worker switching to run/abort state
-            if (res == Status::Run || res == Status::Abort)
-                break;
-        } while (true);
+            status.store(Status::Run, ::std::memory_order_seq_cst); // Synchronize-with previous worker waiting for run/abort state
+            wake_parked(status, parked);
+        } else { // Not latest worker, wait for run status
+            park_until(status, parked, [](Status res) { // Synchronize-with latest worker switching to run/abort state
+                return res == Status::Run || res == Status::Abort;
+            });
+        }
         return true;
     }
     /** Worker notify termination of its run.
@@ -146,10 +155,13 @@ public:
  * @param maxtick_init Timeout for (re)initialization ('Chrono::invalid_tick' for none)
  * @param maxtick_perf Timeout for performance measurements ('Chrono::invalid_tick' for none)
  * @param maxtick_chck Timeout for correctness check ('Chrono::invalid_tick' for none)
- * @return Error constant null-terminated string ('nullptr' for none), execution times (in ns) (undefined if inconsistency detected)
+ * @param placement    Placement of the worker threads
+ * @param perf         Hardware performance counters setup
+ * @return Error constant null-terminated string ('nullptr' for none), execution times (in ns) (undefined if inconsistency detected), hardware counts of the initialization, (all) performance measurements and check, number of transactions committed by (all) the performance measurements, median throughput (in TX/s)
 **/
-static auto measure(Workload& workload, unsigned int const nbthreads, unsigned int const nbrepeats, Seed seed, Chrono::Tick maxtick_init, Chrono::Tick maxtick_perf, Chrono::Tick maxtick_chck) {
+static auto measure(Workload& workload, unsigned int const nbthreads, unsigned int const nbrepeats, Seed seed, Chrono::Tick maxtick_init, Chrono::Tick maxtick_perf, Chrono::Tick maxtick_chck, Placement const& placement, Counters::Setup const& perf) {
     ::std::vector<::std::thread> threads(nbthreads);
+    ::std::vector<::std::array<Counters::Values, 3>> counts(nbthreads); // Hardware counts of each worker, by phase
     ::std::mutex  cerrlock;        // To avoid interleaving writes to 'cerr' in case more than one thread throw
     Sync          sync{nbthreads}; // "As-synchronized-as-possible" starts so that threads interfere "as-much-as-possible"
     
@@ -161,19 +173,32 @@ static auto measure(Workload& workload, unsigned int const nbthreads, unsigned i
                 // It is devided into a series of small tests. Each test is specified in workload.hpp.
                 // Threads are synchronized between each test so that they run with a lot of concurrency.
                 try {
+                    Counters counters{perf}; // Counting this worker only, around each test
+                    auto&    count_of = counts[i];
+
                     // 1. Initialization
                     if (!sync.worker_wait()) return; // Sync. of threads
-                    sync.worker_notify(workload.init()); // Runs the test and tells the master about errors
+                    placement.apply(i); // Pinned before the initialization, so that first touches happen where the worker runs
+                    counters.start();
+                    auto error = workload.init(); // Runs the test
+                    counters.stop(count_of[0]);
+                    sync.worker_notify(error); // Tells the master about errors
 
                     // 2. Performance measurements
                     for (unsigned int count = 0; count < nbrepeats; ++count) {
                         if (!sync.worker_wait()) return;
-                        sync.worker_notify(workload.run(i, seed + nbthreads * count + i));
+                        counters.start();
+                        error = workload.run(i, seed + nbthreads * count + i);
+                        counters.stop(count_of[1]);
+                        sync.worker_notify(error);
                     }
 
                     // 3. Correctness check
                     if (!sync.worker_wait()) return;
-                    sync.worker_notify(workload.check(i, std::random_device{}())); // Random seed is wanted here
+                    counters.start();
+                    error = workload.check(i, std::random_device{}()); // Random seed is wanted here
+                    counters.stop(count_of[2]);
+                    sync.worker_notify(error);
 
                     // Synchronized quit
                     if (!sync.worker_wait()) return;
@@ -202,7 +227,9 @@ static auto measure(Workload& workload, unsigned int const nbthreads, unsigned i
         char const* error = nullptr;
         Chrono::Tick time_init = Chrono::invalid_tick;
         Chrono::Tick times[nbrepeats];
+        double       rates[nbrepeats]; // Throughput of each repetition (in TX/s)
         Chrono::Tick time_chck = Chrono::invalid_tick;
+        uint_fast64_t committed = 0;
         auto const posmedian = nbrepeats / 2;
         { // Initialization (with cheap correctness test)
             sync.master_notify(); // We tell workers to start working.
@@ -215,6 +242,7 @@ static auto measure(Workload& workload, unsigned int const nbthreads, unsigned i
         }
         { // Performance measurements (with cheap correctness tests)
             for (unsigned int i = 0; i < nbrepeats; ++i) {
+                workload.start_run(); // Common start of the run, for the time-bounded runs and the time series
                 sync.master_notify();
                 auto res = sync.master_wait(maxtick_perf);
                 if (unlikely(::std::holds_alternative<char const*>(res))) {
@@ -222,8 +250,12 @@ static auto measure(Workload& workload, unsigned int const nbthreads, unsigned i
                     goto join;
                 }
                 times[i] = ::std::get<Chrono>(res).get_tick();
+                auto run_committed = workload.get_committed(); // Synchronized-with every worker by 'master_wait'
+                rates[i] = static_cast<double>(run_committed) / (static_cast<double>(times[i]) / 1000000000.);
+                committed += run_committed;
             }
             ::std::nth_element(times, times + posmedian, times + nbrepeats); // Partition times around the median
+            ::std::nth_element(rates, rates + posmedian, rates + nbrepeats);
         }
         { // Correctness check
             sync.master_notify();
@@ -239,7 +271,12 @@ static auto measure(Workload& workload, unsigned int const nbthreads, unsigned i
             for (unsigned int i = 0; i < nbthreads; ++i)
                 threads[i].join();
         }
-        return ::std::make_tuple(error, time_init, times[posmedian], time_chck);
+        ::std::array<Counters::Values, 3> total;
+        for (auto const& count_of: counts) {
+            for (size_t phase = 0; phase < total.size(); ++phase)
+                total[phase].merge(count_of[phase]);
+        }
+        return ::std::make_tuple(error, time_init, times[posmedian], time_chck, total, committed, rates[posmedian]);
     } catch (...) {
         for (unsigned int i = 0; i < nbthreads; ++i) // Detach threads to avoid termination due to attached thread going out of scope
             threads[i].detach();
@@ -249,6 +286,337 @@ static auto measure(Workload& workload, unsigned int const nbthreads, unsigned i
 
 // -------------------------------------------------------------------------- //
 
+// Workload parameters shared by the single run and the sweep mode
+constexpr static auto init_balance = 100ul; // Initial account balance
+constexpr static auto slow_factor  = 16ul;  // Timeout, as a multiple of the reference's time
+
+/** Sweep mode configuration, from the '--<name>=<values>' command line options.
+**/
+class SweepConfig final {
+public:
+    ::std::vector<::std::string> workloads; // Names of the workloads ('bank', 'list' or 'hash')
+    ::std::vector<size_t> threads;    // Numbers of worker threads
+    ::std::vector<float>  prob_long;  // Probabilities of running a long, read-only transaction (a lookup for the set workloads)
+    ::std::vector<float>  prob_alloc; // Probabilities of running an allocation transaction (bank workload only)
+    ::std::vector<size_t> accounts;   // Initial numbers of accounts or set elements (0 for 32 per worker)
+    ::std::vector<Skew>   skews;      // Skews of the account selection (bank workload only)
+    size_t       nbtx      = 200000ul; // Total number of transactions per run
+    unsigned int nbrepeats = 7;        // Number of repetitions per point (keep the median)
+    ::std::string output;              // Path of the table to write ('.json' for JSON, CSV otherwise), none if empty
+    Placement    placement;            // Placement of the worker threads
+    Counters::Setup perf;              // Hardware performance counters setup
+    Chrono::Tick duration = 0;         // Duration of a run (in ns), 0 to run the fixed number of transactions
+    Chrono::Tick interval = 0;         // Interval of the throughput time series (in ns), 0 for none
+private:
+    /** Parse a comma-separated list of values.
+     * @param text Text to parse
+     * @param list List to fill
+     * @return Whether the whole text was a non-empty list
+    **/
+    template<class Type> static bool parse_list(char const* text, ::std::vector<Type>& list) {
+        list.clear();
+        ::std::istringstream stream{text};
+        ::std::string item;
+        while (::std::getline(stream, item, ',')) {
+            ::std::istringstream itemstream{item};
+            Type value;
+            if (!(itemstream >> value) || !itemstream.eof())
+                return false;
+            list.push_back(value);
+        }
+        return !list.empty();
+    }
+public:
+    /** Tell whether an option applies to the single run as well, i.e. does not switch to the sweep mode.
+     * @param option Option, '--<name>=<values>'
+     * @return Whether the option is a general one
+    **/
+    static bool is_general(char const* option) noexcept {
+        for (auto prefix: {"--pin=", "--perf=", "--duration=", "--series="}) {
+            if (::std::strncmp(option, prefix, ::std::strlen(prefix)) == 0)
+                return true;
+        }
+        return false;
+    }
+    /** Empty configuration constructor, sweeping the single default point.
+     * @param nbworkers Default number of worker threads
+    **/
+    SweepConfig(size_t nbworkers): workloads{"bank"}, threads{nbworkers}, prob_long{0.5f}, prob_alloc{0.01f}, accounts{0}, skews{Skew{}} {}
+public:
+    /** Parse one option.
+     * @param option Option, '--<name>=<values>'
+     * @return Whether the option is valid
+    **/
+    bool parse(char const* option) {
+        auto equal = ::std::strchr(option, '=');
+        if (!equal)
+            return false;
+        auto name = ::std::string{option + 2, equal};
+        auto value = equal + 1;
+        ::std::vector<size_t> single;
+        if (name == "workload")
+            return parse_list(value, workloads) && ::std::all_of(workloads.begin(), workloads.end(), [](auto const& workload) {
+                return workload == "bank" || workload == "list" || workload == "hash";
+            });
+        if (name == "threads")
+            return parse_list(value, threads) && ::std::find(threads.begin(), threads.end(), 0) == threads.end();
+        if (name == "long")
+            return parse_list(value, prob_long);
+        if (name == "alloc")
+            return parse_list(value, prob_alloc);
+        if (name == "accounts")
+            return parse_list(value, accounts);
+        if (name == "skew") {
+            ::std::vector<::std::string> names;
+            if (!parse_list(value, names))
+                return false;
+            skews.resize(names.size());
+            for (size_t i = 0; i < names.size(); ++i) {
+                if (!skews[i].parse(names[i]))
+                    return false;
+            }
+            return true;
+        }
+        if (name == "txs") {
+            if (!parse_list(value, single) || single.size() != 1 || single[0] == 0)
+                return false;
+            nbtx = single[0];
+            return true;
+        }
+        if (name == "repeats") {
+            if (!parse_list(value, single) || single.size() != 1 || single[0] == 0)
+                return false;
+            nbrepeats = static_cast<unsigned int>(single[0]);
+            return true;
+        }
+        if (name == "pin")
+            return placement.parse(value);
+        if (name == "perf") { // 'on', 'off', or the raw configuration of a coherence event (e.g. HITM loads) to count as well
+            perf.raw = 0;
+            perf.enabled = ::std::strcmp(value, "off") != 0;
+            if (::std::strcmp(value, "on") == 0 || !perf.enabled)
+                return true;
+            char* end;
+            perf.raw = ::std::strtoull(value, &end, 0);
+            return *value != '\0' && *end == '\0' && perf.raw != 0;
+        }
+        if (name == "duration" || name == "series") { // In seconds and milliseconds respectively, 0 to disable
+            char* end;
+            auto amount = ::std::strtod(value, &end);
+            if (*value == '\0' || *end != '\0' || !(amount >= 0.))
+                return false;
+            (name == "duration" ? duration : interval) = static_cast<Chrono::Tick>(amount * (name == "duration" ? 1000000000. : 1000000.));
+            return true;
+        }
+        if (name == "output") {
+            output = value;
+            return !output.empty();
+        }
+        return false;
+    }
+};
+
+/** Describe hardware counts.
+ * @param values Hardware counts
+ * @param div    Divider of each count (e.g. the number of transactions)
+ * @return Description of every counted event
+**/
+static ::std::string describe_counts(Counters::Values const& values, double div) {
+    ::std::ostringstream res;
+    for (size_t i = 0; i < Counters::nbevents; ++i) {
+        if (!values.valid[i])
+            continue;
+        if (res.tellp() > 0)
+            res << ", ";
+        res << static_cast<double>(values.counts[i]) / div << " " << Counters::name(i);
+    }
+    if (res.tellp() == 0)
+        return "not available";
+    return res.str();
+}
+
+/** Get the throughput time series of a workload.
+ * @param workload  Measured workload
+ * @param interval  Interval of the time series (in ns)
+ * @param nbrepeats Number of repetitions the series was summed over
+ * @return Throughput during each interval (in TX/s), averaged over the repetitions
+**/
+static ::std::vector<double> throughput_series(Workload const& workload, Chrono::Tick interval, unsigned int nbrepeats) {
+    ::std::vector<double> res;
+    for (auto committed: workload.get_series())
+        res.push_back(static_cast<double>(committed) / nbrepeats / (static_cast<double>(interval) / 1000000000.));
+    return res;
+}
+
+/** Measured point of a sweep.
+**/
+struct SweepPoint {
+    char const*  library;    // Path of the library
+    char const*  workload;   // Name of the workload
+    char const*  placement;  // Placement policy of the worker threads
+    size_t       nbworkers;  // Number of worker threads
+    float        prob_long;  // Probability of running a long, read-only transaction
+    float        prob_alloc; // Probability of running an allocation transaction
+    size_t       nbaccounts; // Initial number of accounts
+    Skew         skew;       // Skew of the account selection
+    Chrono::Tick tick;       // Median execution time of a run (in ns)
+    double       throughput; // Transactions per second
+    double       speedup;    // Speedup over the reference library (1 for the reference itself)
+    Counters::Values counts; // Hardware counts of the performance measurements
+    double       nbtx;       // Number of transactions these counts are for
+    ::std::vector<double> series; // Throughput during each interval of a run (in TX/s), empty if not recorded
+};
+
+/** Print the hardware counts per transaction.
+ * @param stream Stream to print to
+ * @param values Hardware counts
+ * @param nbtx   Number of transactions these counts are for
+ * @param sep    Separator between two counts
+ * @param none   What to print for an event not counted
+**/
+static void print_per_tx(::std::ostream& stream, Counters::Values const& values, double nbtx, char const* sep, char const* none) {
+    for (size_t i = 0; i < Counters::nbevents; ++i) {
+        if (i > 0)
+            stream << sep;
+        if (values.valid[i]) {
+            stream << static_cast<double>(values.counts[i]) / nbtx;
+        } else {
+            stream << none;
+        }
+    }
+}
+
+/** Write the measured points of a sweep.
+ * @param path   Path of the table ('.json' extension for JSON, CSV otherwise)
+ * @param points Measured points
+ * @return Whether the table was written
+**/
+static bool write_sweep(::std::string const& path, ::std::vector<SweepPoint> const& points) {
+    ::std::ofstream file{path};
+    auto json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (json) {
+        file << "[" << ::std::endl;
+        for (size_t i = 0; i < points.size(); ++i) {
+            auto const& point = points[i];
+            file << "  {\"library\": \"" << point.library << "\", \"workload\": \"" << point.workload << "\", \"placement\": \"" << point.placement << "\", \"threads\": " << point.nbworkers << ", \"prob_long\": " << point.prob_long << ", \"prob_alloc\": " << point.prob_alloc << ", \"accounts\": " << point.nbaccounts << ", \"skew\": \"" << point.skew.name() << "\"" << ", \"time_ns\": " << point.tick << ", \"throughput\": " << point.throughput << ", \"speedup\": " << point.speedup << ", \"per_tx\": [";
+            print_per_tx(file, point.counts, point.nbtx, ", ", "null");
+            file << "], \"series\": [";
+            for (size_t j = 0; j < point.series.size(); ++j)
+                file << (j > 0 ? ", " : "") << point.series[j];
+            file << "]}" << (i + 1 < points.size() ? "," : "") << ::std::endl;
+        }
+        file << "]" << ::std::endl;
+    } else {
+        file << "library,workload,placement,threads,prob_long,prob_alloc,accounts,skew,time_ns,throughput,speedup,cycles_per_tx,instructions_per_tx,llc_misses_per_tx,coherence_per_tx,series" << ::std::endl;
+        for (auto const& point: points) {
+            file << point.library << "," << point.workload << "," << point.placement << "," << point.nbworkers << "," << point.prob_long << "," << point.prob_alloc << "," << point.nbaccounts << "," << point.skew.name() << "," << point.tick << "," << point.throughput << "," << point.speedup << ",";
+            print_per_tx(file, point.counts, point.nbtx, ",", "");
+            file << ",";
+            for (size_t j = 0; j < point.series.size(); ++j)
+                file << (j > 0 ? ";" : "") << point.series[j];
+            file << ::std::endl;
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+/** Build a workload by name.
+ * @param name        Name of the workload ('bank', 'list' or 'hash')
+ * @param library     Transactional library to use
+ * @param nbworkers   Number of concurrent workers
+ * @param nbtxperwrk  Number of transactions per worker
+ * @param nbelems     Initial number of accounts or set elements
+ * @param prob_long   Probability of running a long, read-only transaction (a lookup for the set workloads)
+ * @param prob_alloc  Probability of running an allocation transaction (bank workload only)
+ * @param skew        Skew of the account selection (bank workload only)
+ * @return Built workload
+**/
+static ::std::unique_ptr<Workload> make_workload(::std::string const& name, TransactionalLibrary const& library, size_t nbworkers, size_t nbtxperwrk, size_t nbelems, float prob_long, float prob_alloc, Skew const& skew) {
+    if (name == "list")
+        return ::std::make_unique<WorkloadListSet>(library, nbworkers, nbtxperwrk, nbelems, prob_long);
+    if (name == "hash")
+        return ::std::make_unique<WorkloadHashMap>(library, nbworkers, nbtxperwrk, nbelems, prob_long);
+    return ::std::make_unique<WorkloadBank>(library, nbworkers, nbtxperwrk, nbelems, 8 * nbelems, init_balance, prob_long, prob_alloc, skew);
+}
+
+/** Sweep mode: measure every library at every point of the configuration's matrix.
+ * @param config Sweep configuration
+ * @param seed   Seed to use for performance measurements
+ * @param nblibs Number of libraries (the first one is the reference)
+ * @param libs   Paths of the libraries
+ * @return Program return code
+**/
+static int sweep(SweepConfig const& config, Seed seed, int nblibs, char** libs) {
+    ::std::vector<SweepPoint> points;
+    ::std::vector<::std::unique_ptr<TransactionalLibrary>> tls;
+    for (auto i = 0; i < nblibs; ++i)
+        tls.push_back(::std::make_unique<TransactionalLibrary>(libs[i]));
+    ::std::cout << "⎧ Sweeping " << (config.workloads.size() * config.threads.size() * config.prob_long.size() * config.prob_alloc.size() * config.accounts.size() * config.skews.size()) << " point(s), " << config.nbtx << " TX per run, " << config.nbrepeats << " repetition(s), seed " << seed << ::std::endl;
+    if (config.duration > 0)
+        ::std::cout << "⎪ Run duration: " << (static_cast<double>(config.duration) / 1000000000.) << " s (instead of a fixed number of TX)" << ::std::endl;
+    ::std::cout << "⎪ Thread placement: " << config.placement.describe(*::std::max_element(config.threads.begin(), config.threads.end())) << ::std::endl;
+    for (auto const& workload_name: config.workloads) {
+        for (auto nbworkers: config.threads) {
+            for (auto prob_long: config.prob_long) {
+                for (auto prob_alloc: config.prob_alloc) {
+                    for (auto accounts: config.accounts) {
+                        for (auto const& skew: config.skews) {
+                            auto const nbtxperwrk = ::std::max(config.nbtx / nbworkers, size_t{1});
+                            auto const nbaccounts = accounts > 0 ? accounts : 32 * nbworkers;
+                            auto const pertxdiv   = static_cast<double>(nbworkers) * static_cast<double>(nbtxperwrk);
+                            auto maxtick_init = Chrono::invalid_tick;
+                            auto maxtick_perf = Chrono::invalid_tick;
+                            auto maxtick_chck = Chrono::invalid_tick;
+                            double reference = 0.;
+                            for (auto i = 0; i < nblibs; ++i) {
+                                auto workload = make_workload(workload_name, *tls[i], nbworkers, nbtxperwrk, nbaccounts, prob_long, prob_alloc, skew);
+                                workload->set_duration(config.duration, config.interval);
+                                try {
+                                    auto res = measure(*workload, nbworkers, config.nbrepeats, seed, maxtick_init, maxtick_perf, maxtick_chck, config.placement, config.perf);
+                                    auto error = ::std::get<0>(res);
+                                    if (unlikely(error)) {
+                                        ::std::cout << "⎩ " << libs[i] << ": " << error << ::std::endl;
+                                        return 1;
+                                    }
+                                    auto tick_perf = ::std::get<2>(res);
+                                    auto perfdbl = static_cast<double>(tick_perf);
+                                    auto throughput = config.duration > 0 ? ::std::get<6>(res) : pertxdiv / (perfdbl / 1000000000.);
+                                    if (i == 0) { // Set reference performance for this point
+                                        maxtick_init = slow_factor * ::std::get<1>(res);
+                                        maxtick_perf = slow_factor * tick_perf;
+                                        maxtick_chck = slow_factor * ::std::get<3>(res);
+                                        reference = throughput;
+                                    }
+                                    auto speedup = throughput / reference;
+                                    auto series = config.interval > 0 ? throughput_series(*workload, config.interval, config.nbrepeats) : ::std::vector<double>{};
+                                    points.push_back(SweepPoint{libs[i], workload_name.c_str(), config.placement.name(), nbworkers, prob_long, prob_alloc, nbaccounts, skew, tick_perf, throughput, speedup, ::std::get<4>(res)[1], static_cast<double>(::std::get<5>(res)), ::std::move(series)});
+                                    ::std::cout << "⎪ " << libs[i] << ": " << workload_name << ", " << nbworkers << " threads, long " << prob_long << ", alloc " << prob_alloc << ", " << nbaccounts << " elements, " << skew.name() << " -> " << throughput << " TX/s, " << speedup << " speedup" << ::std::endl;
+                                } catch (::std::exception const& err) { // Special case: cannot unload library with running threads, so print error and quick-exit
+                                    ::std::cerr << "⎪ *** EXCEPTION ***" << ::std::endl;
+                                    ::std::cerr << "⎩ " << err.what() << ::std::endl;
+                                    ::std::quick_exit(2);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (!config.output.empty()) {
+        if (unlikely(!write_sweep(config.output, points))) {
+            ::std::cout << "⎩ Unable to write '" << config.output << "'" << ::std::endl;
+            return 1;
+        }
+        ::std::cout << "⎩ Table written to '" << config.output << "'" << ::std::endl;
+    } else {
+        ::std::cout << "⎩ Done" << ::std::endl;
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------------------- //
+
 /** Program entry point.
  * @param argc Arguments count
  * @param argv Arguments values
@@ -256,11 +624,6 @@ static auto measure(Workload& workload, unsigned int const nbthreads, unsigned i
 **/
 int main(int argc, char** argv) {
     try {
-        // Parse command line option(s)
-        if (argc < 3) {
-            ::std::cout << "Usage: " << (argc > 0 ? argv[0] : "grading") << " <seed> <reference library path> <tested library path>..." << ::std::endl;
-            return 1;
-        }
         // Get/set/compute run parameters
         auto const nbworkers = []() {
             auto res = ::std::thread::hardware_concurrency();
@@ -268,19 +631,40 @@ int main(int argc, char** argv) {
                 res = 16;
             return static_cast<size_t>(res);
         }();
+        // Parse command line option(s), any sweep option (i.e. not a general one) switches to the sweep mode
+        SweepConfig config{nbworkers};
+        auto sweeping = false;
+        auto bad_option = false;
+        while (argc > 1 && ::std::strncmp(argv[1], "--", 2) == 0) {
+            if (unlikely(!config.parse(argv[1])))
+                bad_option = true;
+            if (!SweepConfig::is_general(argv[1]))
+                sweeping = true;
+            argv[1] = argv[0];
+            ++argv;
+            --argc;
+        }
+        if (argc < 3 || bad_option) {
+            ::std::cout << "Usage: " << (argc > 0 ? argv[0] : "grading") << " [--workload=<bank|list|hash,...>] [--threads=<n,...>] [--long=<p,...>] [--alloc=<p,...>] [--accounts=<n,...>] [--skew=<uniform|zipf:theta|hot:fraction:prob,...>] [--txs=<n>] [--repeats=<n>] [--output=<path.csv|path.json>] [--pin=<none|compact|scatter|node>] [--perf=<on|off|raw coherence event>] [--duration=<s>] [--series=<ms>] <seed> <reference library path> <tested library path>..." << ::std::endl;
+            return 1;
+        }
+        if (sweeping)
+            return sweep(config, static_cast<Seed>(::std::stoul(argv[1])), argc - 2, argv + 2);
         auto const nbtxperwrk    = 200000ul / nbworkers;
         auto const nbaccounts    = 32 * nbworkers;
         auto const expnbaccounts = 256 * nbworkers;
-        auto const init_balance  = 100ul;
         auto const prob_long     = 0.5f;
         auto const prob_alloc    = 0.01f;
         auto const nbrepeats     = 7;
         auto const seed          = static_cast<Seed>(::std::stoul(argv[1]));
         auto const clk_res       = Chrono::get_resolution();
-        auto const slow_factor   = 16ul;
         // Print run parameters
         ::std::cout << "⎧ #worker threads:     " << nbworkers << ::std::endl;
-        ::std::cout << "⎪ #TX per worker:      " << nbtxperwrk << ::std::endl;
+        if (config.duration > 0) {
+            ::std::cout << "⎪ Run duration:        " << (static_cast<double>(config.duration) / 1000000000.) << " s" << ::std::endl;
+        } else {
+            ::std::cout << "⎪ #TX per worker:      " << nbtxperwrk << ::std::endl;
+        }
         ::std::cout << "⎪ #repetitions:        " << nbrepeats << ::std::endl;
         ::std::cout << "⎪ Initial #accounts:   " << nbaccounts << ::std::endl;
         ::std::cout << "⎪ Expected #accounts:  " << expnbaccounts << ::std::endl;
@@ -288,6 +672,7 @@ int main(int argc, char** argv) {
         ::std::cout << "⎪ Long TX probability: " << prob_long << ::std::endl;
         ::std::cout << "⎪ Allocation TX prob.: " << prob_alloc << ::std::endl;
         ::std::cout << "⎪ Slow trigger factor: " << slow_factor << ::std::endl;
+        ::std::cout << "⎪ Thread placement:    " << config.placement.describe(nbworkers) << ::std::endl;
         ::std::cout << "⎪ Clock resolution:    ";
         if (unlikely(clk_res == Chrono::invalid_tick)) {
             ::std::cout << "<unknown>" << ::std::endl;
@@ -307,9 +692,10 @@ int main(int argc, char** argv) {
             TransactionalLibrary tl{argv[i]};
             // Initialize workload (shared memory lifetime bound to workload: created and destroyed at the same time)
             WorkloadBank bank{tl, nbworkers, nbtxperwrk, nbaccounts, expnbaccounts, init_balance, prob_long, prob_alloc};
+            bank.set_duration(config.duration, config.interval);
             try {
                 // Actual performance measurements and correctness check
-                auto res = measure(bank, nbworkers, nbrepeats, seed, maxtick_init, maxtick_perf, maxtick_chck);
+                auto res = measure(bank, nbworkers, nbrepeats, seed, maxtick_init, maxtick_perf, maxtick_chck, config.placement, config.perf);
                 // Check false negative-free correctness
                 auto error = ::std::get<0>(res);
                 if (unlikely(error)) {
@@ -321,7 +707,12 @@ int main(int argc, char** argv) {
                 auto tick_perf = ::std::get<2>(res);
                 auto tick_chck = ::std::get<3>(res);
                 auto perfdbl = static_cast<double>(tick_perf);
-                ::std::cout << "⎪ Total user execution time: " << (perfdbl / 1000000.) << " ms";
+                auto throughput = ::std::get<6>(res);
+                if (config.duration > 0) { // Time-bounded runs, compare throughputs
+                    ::std::cout << "⎪ Median throughput: " << throughput << " TX/s";
+                } else {
+                    ::std::cout << "⎪ Total user execution time: " << (perfdbl / 1000000.) << " ms";
+                }
                 if (maxtick_init == Chrono::invalid_tick) { // Set reference performance
                     maxtick_init = slow_factor * tick_init;
                     if (unlikely(maxtick_init == Chrono::invalid_tick)) // Bad luck...
@@ -332,12 +723,41 @@ int main(int argc, char** argv) {
                     maxtick_chck = slow_factor * tick_chck;
                     if (unlikely(maxtick_chck == Chrono::invalid_tick)) // Bad luck...
                         ++maxtick_chck;
-                    reference = perfdbl;
+                    reference = config.duration > 0 ? throughput : perfdbl;
                 } else { // Compare with reference performance
-                    ::std::cout << " -> " << (reference / perfdbl) << " speedup";
+                    ::std::cout << " -> " << (config.duration > 0 ? throughput / reference : reference / perfdbl) << " speedup";
                 }
                 ::std::cout << ::std::endl;
-                ::std::cout << "⎩ Average TX execution time: " << (perfdbl / pertxdiv) << " ns" << ::std::endl;
+                TransactionalMemory::Stats stats;
+                if (bank.get_tm().get_stats(stats)) { // Library keeps statistics (over every repetition)
+                    auto aborts = stats.aborts_read + stats.aborts_write + stats.aborts_alloc;
+                    ::std::cout << "⎪ Commits: " << stats.commits << " (" << stats.ro_commits << " read-only, " << stats.htm_commits << " in hardware), " << stats.htm_fallbacks << " hardware fallbacks" << ::std::endl;
+                    ::std::cout << "⎪ Aborts:  " << aborts << " (" << stats.aborts_read << " read, " << stats.aborts_write << " write, " << stats.aborts_alloc << " alloc)" << ::std::endl;
+                    ::std::cout << "⎪ Epochs:  " << stats.epochs << " (" << (stats.epochs > 0 ? static_cast<double>(stats.epoch_transactions) / static_cast<double>(stats.epochs) : 0.) << " read-write TX each), " << (static_cast<double>(stats.batcher_wait_ns) / 1000000.) << " ms waiting to enter" << ::std::endl;
+                }
+                if (config.perf.enabled) { // Hardware counts, summed over the workers
+                    auto const& counts = ::std::get<4>(res);
+                    ::std::cout << "⎪ Counters (init):  " << describe_counts(counts[0], 1.) << ::std::endl;
+                    ::std::cout << "⎪ Counters per TX:  " << describe_counts(counts[1], static_cast<double>(::std::get<5>(res))) << ::std::endl;
+                    ::std::cout << "⎪ Counters (check): " << describe_counts(counts[2], 1.) << ::std::endl;
+                }
+                { // Per-transaction latencies (over every repetition)
+                    auto const& txtypes = bank.get_tx_types();
+                    auto records = bank.get_records();
+                    for (size_t t = 0; t < txtypes.size(); ++t) {
+                        auto const& record = records[t];
+                        if (record.latencies.count() == 0)
+                            continue;
+                        ::std::cout << "⎪ " << ::std::left << ::std::setw(5) << txtypes[t] << ::std::right << " TX latency: p50 " << record.latencies.percentile(0.5) << " ns, p99 " << record.latencies.percentile(0.99) << " ns, p999 " << record.latencies.percentile(0.999) << " ns (" << record.latencies.count() << " TX, " << record.retries << " retries)" << ::std::endl;
+                    }
+                }
+                if (config.interval > 0) { // Throughput over time (averaged over every repetition)
+                    ::std::cout << "⎪ Throughput per " << (static_cast<double>(config.interval) / 1000000.) << " ms (TX/s):";
+                    for (auto rate: throughput_series(bank, config.interval, nbrepeats))
+                        ::std::cout << " " << rate;
+                    ::std::cout << ::std::endl;
+                }
+                ::std::cout << "⎩ Average TX execution time: " << (config.duration > 0 ? 1000000000. / throughput : perfdbl / pertxdiv) << " ns" << ::std::endl;
             } catch (::std::exception const& err) { // Special case: cannot unload library with running threads, so print error and quick-exit
                 ::std::cerr << "⎪ *** EXCEPTION ***" << ::std::endl;
                 ::std::cerr << "⎩ " << err.what() << ::std::endl;
@@ -32,6 +32,7 @@ extern "C" {
 // Internal headers
 namespace STM {
 #include <tm.hpp>
+#include <tm-ext.hpp>
 }
 #include "common.hpp"
 
@@ -49,6 +50,7 @@ EXCEPTION(Transaction, Any, "transaction manager exception");
     EXCEPTION(TransactionAlign, Transaction, "incorrect alignment detected before transactional operation");
     EXCEPTION(TransactionReadOnly, Transaction, "tried to write/alloc/free using a read-only transaction");
     EXCEPTION(TransactionCreate, Transaction, "shared memory region creation failed");
+    EXCEPTION(TransactionRestore, Transaction, "shared memory region restore failed (or unsupported by the library)");
     EXCEPTION(TransactionBegin, Transaction, "transaction begin failed");
     EXCEPTION(TransactionAlloc, Transaction, "memory allocation failed (insufficient memory)");
     EXCEPTION(TransactionRetry, Transaction, "transaction aborted and can be retried");
@@ -80,6 +82,12 @@ private:
     using FnWrite   = decltype(&STM::tm_write);
     using FnAlloc   = decltype(&STM::tm_alloc);
     using FnFree    = decltype(&STM::tm_free);
+    using FnReadBatch  = decltype(&STM::tm_read_batch);
+    using FnWriteBatch = decltype(&STM::tm_write_batch);
+    using FnStats      = decltype(&STM::tm_stats);
+    using FnCheckpoint = decltype(&STM::tm_checkpoint);
+    using FnRestore    = decltype(&STM::tm_restore);
+    using FnAdd        = decltype(&STM::tm_add);
 private:
     void*     module;     // Module opaque handler
     FnCreate  tm_create;  // Module's initialization function
@@ -93,6 +101,12 @@ private:
     FnWrite   tm_write;   // Module's shared memory write function
     FnAlloc   tm_alloc;   // Module's shared memory allocation function
     FnFree    tm_free;    // Module's shared memory freeing function
+    FnReadBatch  tm_read_batch;  // Module's batched read function (optional, null if missing)
+    FnWriteBatch tm_write_batch; // Module's batched write function (optional, null if missing)
+    FnStats      tm_stats;       // Module's statistics query function (optional, null if missing)
+    FnCheckpoint tm_checkpoint;  // Module's checkpoint writing function (optional, null if missing)
+    FnRestore    tm_restore;     // Module's checkpoint restoring function (optional, null if missing)
+    FnAdd        tm_add;         // Module's blind add function (optional, null if missing)
 private:
     /** Solve a symbol from its name, and bind it to the given function.
      * @param name Name of the symbol to resolve
@@ -107,6 +121,14 @@ private:
     template<class Signature> void solve(char const* name, Signature& func) const {
         func = solve<Signature>(name);
     }
+    /** Solve an optional symbol from its name, and bind it to the given function.
+     * @param name Name of the symbol to resolve
+     * @param func Target function to bind, null if the symbol is missing
+    **/
+    template<class Signature> void solve_optional(char const* name, Signature& func) const {
+        auto res = ::dlsym(module, name);
+        func = res ? *reinterpret_cast<Signature*>(&res) : nullptr;
+    }
 public:
     /** Loader constructor.
      * @param path  Path to the library to load
@@ -133,6 +155,14 @@ public:
             solve("tm_alloc", tm_alloc);
             solve("tm_free", tm_free);
         }
+        { // Bind module's optional extension symbols
+            solve_optional("tm_read_batch", tm_read_batch);
+            solve_optional("tm_write_batch", tm_write_batch);
+            solve_optional("tm_stats", tm_stats);
+            solve_optional("tm_checkpoint", tm_checkpoint);
+            solve_optional("tm_restore", tm_restore);
+            solve_optional("tm_add", tm_add);
+        }
     }
     /** Unloader destructor.
     **/
@@ -157,6 +187,12 @@ public:
     /** Transaction class alias.
     **/
     using TX = STM::tx_t;
+    /** Batched access class alias.
+    **/
+    using Access = STM::Access;
+    /** Statistics class alias.
+    **/
+    using Stats = STM::Stats;
 private:
     TransactionalLibrary const& tl; // Bound transactional library
     Shared shared;     // Handle of the shared memory region used
@@ -179,6 +215,22 @@ public:
             start_addr = tl.tm_start(shared);
         }, "The transactional library takes too long creating the shared memory");
     }
+    /** Restore constructor.
+     * @param library Transactional library to use
+     * @param path    Checkpoint file to restore the shared memory region from (see 'checkpoint')
+    **/
+    TransactionalMemory(TransactionalLibrary const& library, char const* path): tl{library} {
+        if (unlikely(!tl.tm_restore))
+            throw Exception::TransactionRestore{};
+        bounded_run(max_side_time, [&]() {
+            shared = tl.tm_restore(path);
+            if (unlikely(shared == STM::invalid_shared))
+                throw Exception::TransactionRestore{};
+            start_addr = tl.tm_start(shared);
+            start_size = tl.tm_size(shared);
+            alignment  = tl.tm_align(shared);
+        }, "The transactional library takes too long restoring the shared memory");
+    }
     /** Unbind destructor.
     **/
     ~TransactionalMemory() noexcept {
@@ -205,6 +257,23 @@ public:
     auto get_align() const noexcept {
         return alignment;
     }
+    /** [thread-safe] Get the statistics of the shared memory region, if the library keeps some.
+     * @param stats Statistics to fill
+     * @return Whether the library keeps statistics (otherwise 'stats' is left untouched)
+    **/
+    bool get_stats(Stats& stats) const noexcept {
+        if (!tl.tm_stats)
+            return false;
+        tl.tm_stats(shared, &stats);
+        return true;
+    }
+    /** [thread-safe] Write a checkpoint of the shared memory region, outside of any transaction of the calling thread.
+     * @param path Path of the checkpoint file to (over)write
+     * @return Whether the library supports checkpoints and wrote this one
+    **/
+    bool checkpoint(char const* path) const noexcept {
+        return tl.tm_checkpoint && tl.tm_checkpoint(shared, path);
+    }
 public:
     /** [thread-safe] Begin a new transaction on the shared memory region.
      * @param ro Whether the transaction is read-only
@@ -240,6 +309,51 @@ public:
     auto write(TX tx, void const* source, size_t size, void* target) const noexcept {
         return tl.tm_write(shared, tx, source, size, target);
     }
+    /** [thread-safe] Batched read operation in the given transaction, one call to the library if it supports it.
+     * @param tx       Transaction to use
+     * @param accesses Ranges to read, in order
+     * @param count    Number of ranges
+     * @return Whether the whole transaction can continue
+    **/
+    bool read_batch(TX tx, Access const* accesses, size_t count) const noexcept {
+        if (tl.tm_read_batch)
+            return tl.tm_read_batch(shared, tx, accesses, count);
+        for (size_t i = 0; i < count; ++i) {
+            if (unlikely(!read(tx, accesses[i].source, accesses[i].size, accesses[i].target)))
+                return false;
+        }
+        return true;
+    }
+    /** [thread-safe] Batched write operation in the given transaction, one call to the library if it supports it.
+     * @param tx       Transaction to use
+     * @param accesses Ranges to write, in order
+     * @param count    Number of ranges
+     * @return Whether the whole transaction can continue
+    **/
+    bool write_batch(TX tx, Access const* accesses, size_t count) const noexcept {
+        if (tl.tm_write_batch)
+            return tl.tm_write_batch(shared, tx, accesses, count);
+        for (size_t i = 0; i < count; ++i) {
+            if (unlikely(!write(tx, accesses[i].source, accesses[i].size, accesses[i].target)))
+                return false;
+        }
+        return true;
+    }
+    /** [thread-safe] Add operation in the given transaction, one call to the library if it supports it (a read then a write otherwise).
+     * @param tx     Transaction to use
+     * @param target Target 64-bit integer address
+     * @param delta  Value to add
+     * @return Whether the whole transaction can continue
+    **/
+    bool add(TX tx, void* target, int64_t delta) const noexcept {
+        if (tl.tm_add)
+            return tl.tm_add(shared, tx, target, delta);
+        uint64_t value;
+        if (unlikely(!read(tx, target, sizeof(value), &value)))
+            return false;
+        value += static_cast<uint64_t>(delta);
+        return write(tx, &value, sizeof(value), target);
+    }
     /** [thread-safe] Memory allocation operation in the given transaction, throw if no memory available.
      * @param tx     Transaction to use
      * @param size   Size to allocate
@@ -327,6 +441,40 @@ public:
             throw Exception::TransactionRetry{};
         }
     }
+    /** [thread-safe] Batched read operation in the bound transaction, see 'read'.
+     * @param accesses Ranges to read, in order
+     * @param count    Number of ranges
+    **/
+    void read_batch(TransactionalMemory::Access const* accesses, size_t count) {
+        if (unlikely(!tm.read_batch(tx, accesses, count))) {
+            aborted = true;
+            throw Exception::TransactionRetry{};
+        }
+    }
+    /** [thread-safe] Batched write operation in the bound transaction, see 'write'.
+     * @param accesses Ranges to write, in order
+     * @param count    Number of ranges
+    **/
+    void write_batch(TransactionalMemory::Access const* accesses, size_t count) {
+        if (unlikely(assert_mode && is_ro))
+            throw Exception::TransactionReadOnly{};
+        if (unlikely(!tm.write_batch(tx, accesses, count))) {
+            aborted = true;
+            throw Exception::TransactionRetry{};
+        }
+    }
+    /** [thread-safe] Add operation in the bound transaction, see 'add' of the transactional memory.
+     * @param target Target 64-bit integer address
+     * @param delta  Value to add
+    **/
+    void add(void* target, int64_t delta) {
+        if (unlikely(assert_mode && is_ro))
+            throw Exception::TransactionReadOnly{};
+        if (unlikely(!tm.add(tx, target, delta))) {
+            aborted = true;
+            throw Exception::TransactionRetry{};
+        }
+    }
     /** [thread-safe] Memory allocation operation in the bound transaction, throw if no memory available.
      * @param size Size to allocate
      * @return Target start address
@@ -406,6 +554,13 @@ public:
     void operator=(Type const& source) const {
         return write(source);
     }
+    /** Add operation, without reading the content (for 64-bit integers).
+     * @param delta Private value to add to the content at the shared address
+    **/
+    void add(Type delta) const {
+        static_assert(::std::is_integral<Type>::value && sizeof(Type) == sizeof(int64_t), "Only 64-bit integers can be added to");
+        tx.add(address, static_cast<int64_t>(delta));
+    }
 public:
     /** Address of the first byte after the entry.
      * @return First byte after the entry
@@ -602,19 +757,158 @@ public:
 
 // -------------------------------------------------------------------------- //
 
+/** Shared segment binding class, an alternative to chaining 'Shared' bindings field after field.
+ * The transaction and the segment base address are bound (and checked) once, the fields are then located from their
+ * (constant) offsets, and consecutive fields or items are copied in a single transactional read.
+ * @param Header Trivially-copyable header laid at the segment base address
+ * @param Item   Trivially-copyable class of the items laid right after the header (suitably aligned)
+**/
+template<class Header, class Item> class SharedSegment final {
+    static_assert(::std::is_trivially_copyable<Header>::value, "Header class must be trivially copyable");
+    static_assert(::std::is_trivially_copyable<Item>::value, "Item class must be trivially copyable");
+private:
+    constexpr static size_t items_offset = (sizeof(Header) + alignof(Item) - 1) / alignof(Item) * alignof(Item); // Offset of the first item
+private:
+    Transaction& tx; // Bound transaction
+    unsigned char* base; // Segment base address in shared memory
+public:
+    /** Get the segment size for a given number of items.
+     * @param nbitems Number of items in the segment
+     * @return Segment size (in bytes)
+    **/
+    constexpr static size_t size(size_t nbitems) noexcept {
+        return items_offset + nbitems * sizeof(Item);
+    }
+    /** Get the segment alignment.
+     * @return Segment alignment (in bytes)
+    **/
+    constexpr static size_t align() noexcept {
+        return alignof(Header) > alignof(Item) ? alignof(Header) : alignof(Item);
+    }
+    /** Get the offset of a header field.
+     * @param field Header field
+     * @return Offset of the field from the segment base address (in bytes)
+    **/
+    template<class Field> static size_t offset(Field Header::* field) noexcept {
+        Header probe; // Never read, only used to locate the field
+        return reinterpret_cast<unsigned char*>(&(probe.*field)) - reinterpret_cast<unsigned char*>(&probe);
+    }
+public:
+    /** Binding constructor.
+     * @param tx      Bound transaction
+     * @param address Segment base address
+    **/
+    SharedSegment(Transaction& tx, void* address): tx{tx}, base{reinterpret_cast<unsigned char*>(address)} {
+        if (unlikely(assert_mode && reinterpret_cast<uintptr_t>(address) % tx.get_tm().get_align() != 0))
+            throw Exception::SharedAlign{};
+        if (unlikely(assert_mode && reinterpret_cast<uintptr_t>(address) % align() != 0))
+            throw Exception::SharedAlign{};
+    }
+public:
+    /** Get the segment base address in shared memory.
+     * @return Segment base address
+    **/
+    void* get() const noexcept {
+        return base;
+    }
+    /** Get the address of a header field in shared memory.
+     * @param field Header field
+     * @return Address of the field
+    **/
+    template<class Field> Field* get(Field Header::* field) const noexcept {
+        return reinterpret_cast<Field*>(base + offset(field));
+    }
+    /** Get the address of an item in shared memory.
+     * @param index Index of the item
+     * @return Address of the item
+    **/
+    Item* item(size_t index) const noexcept {
+        return reinterpret_cast<Item*>(base + items_offset) + index;
+    }
+public:
+    /** Read a header field.
+     * @param field Header field
+     * @return Private copy of the field
+    **/
+    template<class Field> Field read(Field Header::* field) const {
+        Field res;
+        tx.read(get(field), sizeof(Field), &res);
+        return res;
+    }
+    /** Write a header field.
+     * @param field  Header field
+     * @param source Private content to write in the field
+    **/
+    template<class Field> void write(Field Header::* field, Field const& source) const {
+        tx.write(&source, sizeof(Field), get(field));
+    }
+    /** Read consecutive header fields in a single transactional read.
+     * @param first  First header field to read
+     * @param last   Last header field to read (included, not before the first one)
+     * @param target Private header receiving the fields (the other ones are left untouched)
+    **/
+    template<class First, class Last> void read(First Header::* first, Last Header::* last, Header& target) const {
+        auto const from = offset(first);
+        auto const size = offset(last) + sizeof(Last) - from;
+        if (unlikely(assert_mode && size % tx.get_tm().get_align() != 0))
+            throw Exception::SharedAlign{};
+        tx.read(base + from, size, reinterpret_cast<unsigned char*>(&target) + from);
+    }
+    /** Read the whole header in a single transactional read.
+     * @return Private copy of the header
+    **/
+    Header read() const {
+        Header res;
+        tx.read(base, sizeof(Header), &res);
+        return res;
+    }
+    /** Read an item.
+     * @param index Index of the item
+     * @return Private copy of the item
+    **/
+    Item read_item(size_t index) const {
+        Item res;
+        tx.read(item(index), sizeof(Item), &res);
+        return res;
+    }
+    /** Write an item.
+     * @param index  Index of the item
+     * @param source Private content to write in the item
+    **/
+    void write_item(size_t index, Item const& source) const {
+        tx.write(&source, sizeof(Item), item(index));
+    }
+    /** Read consecutive items in a single transactional read.
+     * @param first  Index of the first item to read
+     * @param count  Number of items to read (non-zero)
+     * @param target Private array receiving the items
+    **/
+    void read_items(size_t first, size_t count, Item* target) const {
+        tx.read(item(first), count * sizeof(Item), target);
+    }
+};
+
+// -------------------------------------------------------------------------- //
+
 /** Repeat a given transaction until it commits.
- * @param tm   Transactional memory
- * @param mode Transactional mode
- * @param func Transaction closure (Transaction& -> ...)
+ * @param tm      Transactional memory
+ * @param mode    Transactional mode
+ * @param func    Transaction closure (Transaction& -> ...)
+ * @param retries Counter of the aborted attempts, incremented for each
  * @return Returned value (or void) when the transaction committed
 **/
-template<class Func> static auto transactional(TransactionalMemory const& tm, Transaction::Mode mode, Func&& func) {
+template<class Func> static auto transactional(TransactionalMemory const& tm, Transaction::Mode mode, Func&& func, uint_fast64_t& retries) {
     do {
         try {
             Transaction tx{tm, mode};
             return func(tx);
         } catch (Exception::TransactionRetry const&) {
+            ++retries;
             continue;
         }
     } while (true);
 }
+template<class Func> static auto transactional(TransactionalMemory const& tm, Transaction::Mode mode, Func&& func) {
+    uint_fast64_t retries = 0;
+    return transactional(tm, mode, ::std::forward<Func>(func), retries);
+}
@@ -24,8 +24,15 @@
 #pragma once
 
 // External headers
+#include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
 #include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 // Internal headers
 #include "common.hpp"
@@ -40,26 +47,288 @@ using Uid = uint_fast32_t;
 **/
 using Seed = uint_fast32_t;
 
+/** Latency and retries record of one transaction type.
+**/
+struct TxRecord {
+    Histogram     latencies;   // Latencies of the transactions (in ns), retries included
+    uint_fast64_t retries = 0; // Number of aborted attempts
+    /** Add another record to this one.
+     * @param other Record to merge
+    **/
+    void merge(TxRecord const& other) noexcept {
+        latencies.merge(other.latencies);
+        retries += other.retries;
+    }
+};
+
+/** Skew of the selection of an index among a (changing) number of them, the lowest indexes being the hottest.
+**/
+class Skew final {
+public:
+    /** Selection kind.
+    **/
+    enum class Kind {
+        uniform, // Every index is as likely
+        zipf,    // Index i picked with probability proportional to 1 / (i + 1)^theta
+        hotset   // A 'fraction' of the indexes picked with probability 'prob', the others sharing the rest
+    };
+public:
+    Kind   kind     = Kind::uniform;
+    double theta    = 0.;  // Zipf exponent, in [0, 1)
+    double fraction = 0.;  // Fraction of the indexes in the hot set, in (0, 1]
+    double prob     = 0.;  // Probability of picking an index of the hot set, in [0, 1]
+public:
+    /** Parse a skew description.
+     * @param text Description, one of 'uniform', 'zipf:<theta>' or 'hot:<fraction>:<prob>'
+     * @return Whether the description was valid
+    **/
+    bool parse(::std::string const& text) {
+        auto number = [](::std::string const& item, double& value) {
+            char* end;
+            value = ::std::strtod(item.c_str(), &end);
+            return !item.empty() && *end == '\0';
+        };
+        if (text == "uniform") {
+            kind = Kind::uniform;
+            return true;
+        }
+        if (text.compare(0, 5, "zipf:") == 0) {
+            kind = Kind::zipf;
+            return number(text.substr(5), theta) && theta >= 0. && theta < 1.;
+        }
+        if (text.compare(0, 4, "hot:") == 0) {
+            auto colon = text.find(':', 4);
+            if (colon == ::std::string::npos)
+                return false;
+            kind = Kind::hotset;
+            return number(text.substr(4, colon - 4), fraction) && number(text.substr(colon + 1), prob) && fraction > 0. && fraction <= 1. && prob >= 0. && prob <= 1.;
+        }
+        return false;
+    }
+    /** Get the description of this skew.
+     * @return Description, as accepted by 'parse'
+    **/
+    ::std::string name() const {
+        ::std::ostringstream res;
+        switch (kind) {
+        case Kind::zipf:
+            res << "zipf:" << theta;
+            break;
+        case Kind::hotset:
+            res << "hot:" << fraction << ":" << prob;
+            break;
+        default:
+            res << "uniform";
+        }
+        return res.str();
+    }
+};
+
+/** Skewed index selection class, for one worker.
+**/
+class SkewedIndex final {
+private:
+    Skew   skew;  // Selection skew
+    size_t n;     // Number of indexes the Zipf constants were computed for
+    double zetan; // Zeta constant (sum of 1 / i^theta for i in [1, n])
+    double zeta2; // Zeta constant for 2 indexes
+    double eta;   // Zipf constant derived from 'n', 'zetan' and 'zeta2'
+    ::std::uniform_real_distribution<double> unit; // Uniform distribution in [0, 1)
+private:
+    /** Update the Zipf constants for a new number of indexes, summing only the terms that changed.
+     * @param count New number of indexes
+    **/
+    void resize(size_t count) {
+        for (; n < count; ++n)
+            zetan += 1. / ::std::pow(static_cast<double>(n + 1), skew.theta);
+        for (; n > count; --n)
+            zetan -= 1. / ::std::pow(static_cast<double>(n), skew.theta);
+        eta = (1. - ::std::pow(2. / static_cast<double>(n), 1. - skew.theta)) / (1. - zeta2 / zetan);
+    }
+public:
+    /** Sampler constructor.
+     * @param skew Selection skew
+    **/
+    SkewedIndex(Skew const& skew): skew{skew}, n{0}, zetan{0.}, zeta2{1. + ::std::pow(0.5, skew.theta)}, eta{0.}, unit{0., 1.} {}
+public:
+    /** Pick an index.
+     * @param engine Randomness source
+     * @param count  Number of indexes, at least 1
+     * @return Index in [0, count)
+    **/
+    template<class Engine> size_t operator()(Engine& engine, size_t count) {
+        switch (skew.kind) {
+        case Skew::Kind::zipf: { // Gray et al., "Quickly generating billion-record synthetic databases", SIGMOD'94
+            if (count != n)
+                resize(count);
+            auto u = unit(engine);
+            auto uz = u * zetan;
+            if (uz < 1. || count == 1)
+                return 0;
+            if (uz < zeta2)
+                return 1;
+            auto index = static_cast<size_t>(static_cast<double>(count) * ::std::pow(eta * u - eta + 1., 1. / (1. - skew.theta)));
+            return ::std::min(index, count - 1);
+        }
+        case Skew::Kind::hotset: {
+            auto hot = ::std::max(static_cast<size_t>(skew.fraction * static_cast<double>(count)), size_t{1});
+            if (hot >= count || unit(engine) < skew.prob)
+                return ::std::uniform_int_distribution<size_t>{0, ::std::min(hot, count) - 1}(engine);
+            return ::std::uniform_int_distribution<size_t>{hot, count - 1}(engine);
+        }
+        default:
+            return ::std::uniform_int_distribution<size_t>{0, count - 1}(engine);
+        }
+    }
+};
+
 /** Workload base class.
 **/
 class Workload {
 protected:
     TransactionalLibrary const& tl;  // Associated transactional library
     TransactionalMemory         tm;  // Built transactional memory to use
+private:
+    /** Progress of one worker in its current run.
+    **/
+    struct Progress {
+        Chrono        clock;         // Started at the common start of the run
+        uint_fast64_t committed = 0; // Number of transactions committed by the run
+        ::std::vector<uint_fast64_t> series; // Number of transactions committed during each interval, over every run
+    };
+    ::std::vector<char const*> txtypes; // Names of the transaction types, by type index
+    ::std::vector<::std::vector<TxRecord>> mutable records; // Records of each worker (by uid), by type index
+    ::std::vector<Progress> mutable progress; // Progress of each worker (by uid)
+    Chrono run_clock; // Started at the common start of the next run
+    Chrono::Tick duration = 0; // Duration of a run (in ns), 0 to run a fixed number of transactions instead
+    Chrono::Tick interval = 0; // Interval of the time series (in ns), 0 for none
 public:
     /** Deleted copy constructor/assignment.
     **/
     Workload(Workload const&) = delete;
     Workload& operator=(Workload const&) = delete;
     /** Transactional memory constructor.
-     * @param library Transactional library to use
-     * @param align   Shared memory region required alignment
-     * @param size    Size of the shared memory region to allocate
+     * @param library   Transactional library to use
+     * @param align     Shared memory region required alignment
+     * @param size      Size of the shared memory region to allocate
+     * @param nbworkers Number of concurrent workers
+     * @param txtypes   Names of the transaction types to record
     **/
-    Workload(TransactionalLibrary const& library, size_t align, size_t size): tl{library}, tm{tl, align, size} {}
+    Workload(TransactionalLibrary const& library, size_t align, size_t size, size_t nbworkers, ::std::initializer_list<char const*> txtypes): tl{library}, tm{tl, align, size}, txtypes{txtypes}, records(nbworkers, ::std::vector<TxRecord>(txtypes.size())), progress(nbworkers) {}
     /** Virtual destructor.
     **/
     virtual ~Workload() {};
+public:
+    /** Get the built transactional memory.
+     * @return Built transactional memory
+    **/
+    auto const& get_tm() const noexcept {
+        return tm;
+    }
+    /** Get the names of the recorded transaction types.
+     * @return Names, by type index
+    **/
+    auto const& get_tx_types() const noexcept {
+        return txtypes;
+    }
+    /** Run for some time instead of a fixed number of transactions, and/or record a time series.
+     * @param duration Duration of a run (in ns), 0 to run the fixed number of transactions
+     * @param interval Interval of the time series (in ns), 0 for none
+    **/
+    void set_duration(Chrono::Tick duration, Chrono::Tick interval) noexcept {
+        this->duration = duration;
+        this->interval = interval;
+    }
+    /** Mark the common start of the next run, before letting the workers in.
+    **/
+    void start_run() noexcept {
+        run_clock.start();
+    }
+    /** Count the transactions the last run committed.
+     * @return Number of transactions committed by every worker
+    **/
+    auto get_committed() const noexcept {
+        uint_fast64_t res = 0;
+        for (auto const& worker: progress)
+            res += worker.committed;
+        return res;
+    }
+    /** Merge the time series of every worker.
+     * @return Number of transactions committed during each interval, summed over every run (when running for some time, only the intervals before the end of the run)
+    **/
+    auto get_series() const {
+        ::std::vector<uint_fast64_t> res;
+        for (auto const& worker: progress) {
+            if (worker.series.size() > res.size())
+                res.resize(worker.series.size(), 0);
+            for (size_t i = 0; i < worker.series.size(); ++i)
+                res[i] += worker.series[i];
+        }
+        if (duration > 0 && interval > 0 && res.size() > duration / interval)
+            res.resize(duration / interval);
+        return res;
+    }
+    /** Merge the records of every worker.
+     * @return Records of the transactions run by 'run', by type index
+    **/
+    auto get_records() const {
+        ::std::vector<TxRecord> res(txtypes.size());
+        for (auto const& worker: records) {
+            for (size_t i = 0; i < res.size(); ++i)
+                res[i].merge(worker[i]);
+        }
+        return res;
+    }
+protected:
+    /** [thread-safe] Start the run of the calling worker, from the common start of the run.
+     * @param uid Unique ID of the calling worker
+    **/
+    void begin_run(Uid uid) const noexcept {
+        auto& worker = progress[uid];
+        worker.committed = 0;
+        worker.clock = run_clock;
+    }
+    /** [thread-safe] Tell whether the run of the calling worker goes on.
+     * @param uid   Unique ID of the calling worker
+     * @param cntr  Number of transactions already run
+     * @param limit Number of transactions to run, if not running for some time
+     * @return Whether to run another transaction
+    **/
+    bool keep_running(Uid uid, size_t cntr, size_t limit) const noexcept {
+        if (duration == 0)
+            return cntr < limit;
+        return progress[uid].clock.delta() < duration;
+    }
+    /** [thread-safe] Run and record one transaction, into the records of the calling worker only.
+     * @param uid  Unique ID of the calling worker
+     * @param type Index of the transaction type
+     * @param func Transaction to run (uint_fast64_t& retries -> ...)
+     * @return Returned value (or void)
+    **/
+    template<class Func> auto recorded(Uid uid, size_t type, Func&& func) const {
+        auto& record = records[uid][type];
+        auto& worker = progress[uid];
+        auto account = [&](Chrono::Tick latency) {
+            record.latencies.record(latency);
+            ++worker.committed;
+            if (interval > 0) {
+                auto slot = static_cast<size_t>(worker.clock.delta() / interval);
+                if (slot >= worker.series.size())
+                    worker.series.resize(slot + 1, 0);
+                ++worker.series[slot];
+            }
+        };
+        Chrono chrono;
+        chrono.start();
+        if constexpr (::std::is_void_v<decltype(func(record.retries))>) {
+            func(record.retries);
+            account(chrono.delta());
+        } else {
+            auto res = func(record.retries);
+            account(chrono.delta());
+            return res;
+        }
+    }
 public:
     /** Shared memory (re)initialization.
      * @return Constant null-terminated error message, 'nullptr' for none
@@ -116,6 +385,8 @@ private:
         constexpr static auto align() noexcept {
             return alignof(Dummy);
         }
+    private:
+        Transaction& tx; // Associated pending transaction
     public:
         Shared<size_t>         count; // Number of allocated accounts in this segment
         Shared<AccountSegment*> next; // Next allocated segment
@@ -130,8 +401,32 @@ private:
          * @param tx      Associated pending transaction
          * @param address Block base address
         **/
-        AccountSegment(Transaction& tx, void* address): count{tx, address}, next{tx, count.after()}, parity{tx, next.after()}, accounts{tx, parity.after()} {}
+        AccountSegment(Transaction& tx, void* address): tx{tx}, count{tx, address}, next{tx, count.after()}, parity{tx, next.after()}, accounts{tx, parity.after()} {}
+    public:
+        /** Read the consecutive header fields in a single batched read.
+         * @param count  Number of allocated accounts in this segment
+         * @param next   Next allocated segment
+         * @param parity Segment balance correction (optional, not read if null)
+        **/
+        void read_header(size_t& count, void*& next, Balance* parity = nullptr) const {
+            TransactionalMemory::Access const accesses[] = {
+                {this->count.get(), sizeof(size_t), &count},
+                {this->next.get(), sizeof(AccountSegment*), &next},
+                {this->parity.get(), sizeof(Balance), parity}
+            };
+            tx.read_batch(accesses, parity ? 3 : 2);
+        }
+    };
+    /** Header of a shared segment of accounts, as laid out by 'AccountSegment'.
+    **/
+    struct AccountHeader {
+        size_t  count;  // Number of allocated accounts in this segment
+        void*   next;   // Next allocated segment
+        Balance parity; // Segment balance correction for when deleting an account
     };
+    /** Shared segment of accounts, bound once for the segment walks.
+    **/
+    using AccountBlock = SharedSegment<AccountHeader, Balance>;
 private:
     size_t  nbworkers;     // Number of concurrent workers
     size_t  nbtxperwrk;    // Number of transactions per worker
@@ -140,6 +435,7 @@ private:
     Balance init_balance;  // Initial account balance
     float   prob_long;     // Probability of running a long, read-only control transaction
     float   prob_alloc;    // Probability of running an allocation/deallocation transaction, knowing a long transaction won't run
+    Skew    skew;          // Skew of the sender and receiver selection of the short transactions
     Barrier barrier;       // Barrier for thread synchronization during 'check'
 public:
     /** Bank workload constructor.
@@ -151,48 +447,59 @@ public:
      * @param init_balance  Initial account balance
      * @param prob_long     Probability of running a long, read-only control transaction
      * @param prob_alloc    Probability of running an allocation/deallocation transaction, knowing a long transaction won't run
+     * @param skew          Skew of the sender and receiver selection (the first accounts being the hottest)
     **/
-    WorkloadBank(TransactionalLibrary const& library, size_t nbworkers, size_t nbtxperwrk, size_t nbaccounts, size_t expnbaccounts, Balance init_balance, float prob_long, float prob_alloc): Workload{library, AccountSegment::align(), AccountSegment::size(nbaccounts)}, nbworkers{nbworkers}, nbtxperwrk{nbtxperwrk}, nbaccounts{nbaccounts}, expnbaccounts{expnbaccounts}, init_balance{init_balance}, prob_long{prob_long}, prob_alloc{prob_alloc}, barrier{nbworkers} {}
+    WorkloadBank(TransactionalLibrary const& library, size_t nbworkers, size_t nbtxperwrk, size_t nbaccounts, size_t expnbaccounts, Balance init_balance, float prob_long, float prob_alloc, Skew const& skew = Skew{}): Workload{library, AccountSegment::align(), AccountSegment::size(nbaccounts), nbworkers, {"long", "alloc", "short"}}, nbworkers{nbworkers}, nbtxperwrk{nbtxperwrk}, nbaccounts{nbaccounts}, expnbaccounts{expnbaccounts}, init_balance{init_balance}, prob_long{prob_long}, prob_alloc{prob_alloc}, skew{skew}, barrier{nbworkers} {
+        static_assert(AccountBlock::size(1) == AccountSegment::size(1) && AccountBlock::align() == AccountSegment::align(), "AccountBlock does not match the AccountSegment layout");
+    }
 private:
     /** Long read-only transaction, summing the balance of each account.
-     * @param count Loosely-updated number of accounts
+     * @param count   Loosely-updated number of accounts
+     * @param retries Counter of the aborted attempts
      * @return Whether no inconsistency has been found
     **/
-    bool long_tx(size_t& nbaccounts) const {
+    bool long_tx(size_t& nbaccounts, uint_fast64_t& retries) const {
+        ::std::vector<Balance> balances(this->nbaccounts); // Private copy of one segment of accounts, reused across segments and retries.
         return transactional(tm, Transaction::Mode::read_only, [&](Transaction& tx) {
             auto count = 0ul; // Total number of accounts seen.
             auto sum   = Balance{0}; // Total balance on all seen accounts + parity ammount.
             auto start = tm.get_start(); // The list of accounts starts at the first word of the shared memory region.
             while (start) {
-                AccountSegment segment{tx, start}; // We interpret the memory as a segment/array of accounts.
-                decltype(count) segment_count = segment.count;
-                count += segment_count; // And accumulate the total number of accounts.
-                sum += segment.parity; // We also sum the money that results from the destruction of accounts.
-                for (decltype(count) i = 0; i < segment_count; ++i) {
-                    Balance local = segment.accounts[i];
+                AccountBlock segment{tx, start}; // We interpret the memory as a segment/array of accounts.
+                auto const header = segment.read();
+                if (unlikely(header.count > balances.size())) // More accounts than a segment can hold, there's a consistency issue.
+                    return false;
+                count += header.count; // And accumulate the total number of accounts.
+                sum += header.parity; // We also sum the money that results from the destruction of accounts.
+                if (header.count > 0)
+                    segment.read_items(0, header.count, balances.data()); // All the accounts of the segment in one read.
+                for (decltype(count) i = 0; i < header.count; ++i) {
+                    auto local = balances[i];
                     if (unlikely(local < 0)) // If one account has a negative balance, there's a consistency issue.
                         return false;
                     sum += local;
                 }
-                start = segment.next; // Accounts are stored in linked segments, we move to the next one.
+                start = header.next; // Accounts are stored in linked segments, we move to the next one.
             }
             nbaccounts = count;
             return sum == static_cast<Balance>(init_balance * count); // Consistency check: no money should ever be destroyed or created out of thin air.
-        });
+        }, retries);
     }
     /** Account (de)allocation transaction, adding accounts with initial balance or removing them.
      * @param trigger Trigger level that will decide whether to allocate or deallocate
+     * @param retries Counter of the aborted attempts
     **/
-    void alloc_tx(size_t trigger) const {
+    void alloc_tx(size_t trigger, uint_fast64_t& retries) const {
         return transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
             auto count = 0ul; // Total number of accounts seen.
             void* prev = nullptr;
             auto start = tm.get_start();
             while (true) {
                 AccountSegment segment{tx, start};
-                decltype(count) segment_count = segment.count;
+                decltype(count) segment_count;
+                decltype(start) segment_next;
+                segment.read_header(segment_count, segment_next);
                 count += segment_count;
-                decltype(start) segment_next = segment.next;
                 if (!segment_next) { // Currently at the last segment
                     if (count > trigger && likely(count > 2)) { // If we have seen "too many" accounts, we will destroy one.
                         --segment_count; // Let's remove the last account from the last segment.
@@ -222,14 +529,15 @@ private:
                 prev  = start;
                 start = segment_next;
             }
-        });
+        }, retries);
     }
     /** Short read-write transaction, transferring one unit from an account to an account (potentially the same).
      * @param send_id Index of the sender account
      * @param recv_id Index of the receiver account (potentially same as source)
+     * @param retries Counter of the aborted attempts
      * @return Whether the parameters were satisfying and the transaction committed on useful work
     **/
-    bool short_tx(size_t send_id, size_t recv_id) const {
+    bool short_tx(size_t send_id, size_t recv_id, uint_fast64_t& retries) const {
         return transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
             void* send_ptr = nullptr;
             void* recv_ptr = nullptr;
@@ -237,27 +545,28 @@ private:
             // Get the account pointers in shared memory
             auto start = tm.get_start();
             while (true) {
-                AccountSegment segment{tx, start};
-                size_t segment_count = segment.count;
+                AccountBlock segment{tx, start};
+                AccountHeader header;
+                segment.read(&AccountHeader::count, &AccountHeader::next, header); // The parity is not needed, leave it out of the read set.
                 if (!send_ptr) {
-                    if (send_id < segment_count) {
-                        send_ptr = segment.accounts[send_id].get();
+                    if (send_id < header.count) {
+                        send_ptr = segment.item(send_id);
                         if (recv_ptr)
                             break;
                     } else {
-                        send_id -= segment_count;
+                        send_id -= header.count;
                     }
                 }
                 if (!recv_ptr) {
-                    if (recv_id < segment_count) {
-                        recv_ptr = segment.accounts[recv_id].get();
+                    if (recv_id < header.count) {
+                        recv_ptr = segment.item(recv_id);
                         if (send_ptr)
                             break;
                     } else {
-                        recv_id -= segment_count;
+                        recv_id -= header.count;
                     }
                 }
-                start = segment.next;
+                start = header.next;
                 if (!start) // Current segment is the last segment
                     return false; // At least one account does not exist => do nothing
             }
@@ -268,10 +577,10 @@ private:
             auto send_val = sender.read();
             if (send_val > 0) {
                 sender = send_val - 1;
-                recver = recver.read() + 1;
+                recver.add(1); // Blind, so that transfers to the same account need not conflict.
             }
             return true;
-        });
+        }, retries);
     }
 public:
     /**
@@ -294,29 +603,31 @@ public:
     }
 
     /**
-     * Run nbtxperwrk random transactions until completion.
+     * Run nbtxperwrk random transactions (or as many as the run duration allows) until completion.
      * @param seed Randomness source
     **/
-    virtual char const* run(Uid uid [[gnu::unused]], Seed seed) const {
+    virtual char const* run(Uid uid, Seed seed) const {
         ::std::minstd_rand engine{seed};
         ::std::bernoulli_distribution long_dist{prob_long};
         ::std::bernoulli_distribution alloc_dist{prob_alloc};
         ::std::gamma_distribution<float> alloc_trigger(expnbaccounts, 1);
+        SkewedIndex account{skew}; // The first accounts are the hottest, and are never deallocated
         size_t count = nbaccounts;
-        for (size_t cntr = 0; cntr < nbtxperwrk; ++cntr) {
+        begin_run(uid);
+        for (size_t cntr = 0; keep_running(uid, cntr, nbtxperwrk); ++cntr) {
             if (long_dist(engine)) { // We roll a dice and, if "lucky", run a long transaction.
-                if (unlikely(!long_tx(count))) // If it fails, then we return an error message.
+                if (unlikely(!recorded(uid, 0, [&](uint_fast64_t& retries) { return long_tx(count, retries); }))) // If it fails, then we return an error message.
                     return "Violated isolation or atomicity";
             } else if (alloc_dist(engine)) { // Let's roll a dice again to trigger an allocation transaction.
-                alloc_tx(alloc_trigger(engine));
+                auto trigger = alloc_trigger(engine);
+                recorded(uid, 1, [&](uint_fast64_t& retries) { alloc_tx(trigger, retries); });
             } else { // No luck with previous rolls, let's just run a short transaction.
-                ::std::uniform_int_distribution<size_t> account{0, count - 1};
-                while (unlikely(!short_tx(account(engine), account(engine))));
+                while (unlikely(!recorded(uid, 2, [&](uint_fast64_t& retries) { return short_tx(account(engine, count), account(engine, count), retries); })));
             }
         }
         { // Last long transaction
             size_t dummy;
-            if (!long_tx(dummy))
+            if (!recorded(uid, 0, [&](uint_fast64_t& retries) { return long_tx(dummy, retries); }))
                 return "Violated isolation or atomicity";
         }
         return nullptr;
@@ -328,7 +639,7 @@ public:
     virtual char const* check(Uid uid, Seed seed [[gnu::unused]]) const {
         constexpr size_t nbtxperwrk = 100;
 
-        barrier.sync();
+        barrier.sync(uid);
         if (uid == 0) { // Only the first thread initializes the shared memory.
             // We first write the initial value,
             auto init_counter = nbtxperwrk * nbworkers;
@@ -343,14 +654,14 @@ public:
                 return counter == init_counter;
             });
             if (unlikely(!correct)) {
-                barrier.sync();
-                barrier.sync();
+                barrier.sync(uid);
+                barrier.sync(uid);
                 return "Violated consistency during initialization";
             }
         }
 
         // In each thread,
-        barrier.sync();
+        barrier.sync(uid);
         for (size_t i = 0; i < nbtxperwrk; ++i) {
 
             // We first fetch the last value of the counter,
@@ -369,13 +680,13 @@ public:
                 return true;
             });
             if (unlikely(!correct)) {
-                barrier.sync();
+                barrier.sync(uid);
                 return "Violated consistency, isolation or atomicity";
             }
         }
 
         // Finally, a last transaction runs in the first thread to check that the counter reached 0 (i.e., each transaction decreased it by 1.).
-        barrier.sync();
+        barrier.sync(uid);
         if (uid == 0) {
             auto correct = transactional(tm, Transaction::Mode::read_only, [&](Transaction& tx) {
                 Shared<size_t> counter{tx, tm.get_start()};
@@ -387,3 +698,418 @@ public:
         return nullptr;
     }
 };
+
+// -------------------------------------------------------------------------- //
+
+/** Set workload base class: lookups, insertions and removals of random keys,
+ * over a set structure defined by the derived class.
+**/
+class WorkloadSet: public Workload {
+protected:
+    size_t nbworkers;   // Number of concurrent workers
+    size_t nbtxperwrk;  // Number of transactions per worker
+    size_t nbelems;     // Initial number of elements (the even keys of the range)
+    size_t range;       // Keys of the running workers are in [1, range]
+    float  prob_lookup; // Probability of running a lookup (read-only) transaction, insertions and removals sharing the rest
+    Barrier barrier;    // Barrier for thread synchronization during 'check'
+    ::std::vector<int_fast64_t> mutable deltas; // Net number of elements each worker (by uid) inserted
+    constexpr static size_t nbcheckkeys = 16; // Number of private keys each worker inserts and removes during 'check'
+public:
+    /** Set workload constructor.
+     * @param library     Transactional library to use
+     * @param align       Shared memory region required alignment
+     * @param size        Size of the shared memory region to allocate
+     * @param nbworkers   Total number of concurrent threads (for both 'run' and 'check')
+     * @param nbtxperwrk  Number of transactions per worker
+     * @param nbelems     Initial number of elements
+     * @param prob_lookup Probability of running a lookup transaction
+    **/
+    WorkloadSet(TransactionalLibrary const& library, size_t align, size_t size, size_t nbworkers, size_t nbtxperwrk, size_t nbelems, float prob_lookup): Workload{library, align, size, nbworkers, {"lookup", "insert", "remove"}}, nbworkers{nbworkers}, nbtxperwrk{nbtxperwrk}, nbelems{nbelems}, range{2 * nbelems}, prob_lookup{prob_lookup}, barrier{nbworkers}, deltas(nbworkers, 0) {}
+protected:
+    /** Lookup transaction.
+     * @param key     Key to look for
+     * @param retries Counter of the aborted attempts
+     * @return Whether the key is in the set
+    **/
+    virtual bool lookup_tx(size_t key, uint_fast64_t& retries) const = 0;
+    /** Insertion transaction.
+     * @param key     Key to insert
+     * @param retries Counter of the aborted attempts
+     * @return Whether the key was inserted (i.e. was not in the set)
+    **/
+    virtual bool insert_tx(size_t key, uint_fast64_t& retries) const = 0;
+    /** Removal transaction.
+     * @param key     Key to remove
+     * @param retries Counter of the aborted attempts
+     * @return Whether the key was removed (i.e. was in the set)
+    **/
+    virtual bool remove_tx(size_t key, uint_fast64_t& retries) const = 0;
+    /** Check the invariants of the whole set, while no other transaction runs.
+     * @param expected Expected number of elements
+     * @return Constant null-terminated error message, 'nullptr' for none
+    **/
+    virtual char const* validate(size_t expected) const = 0;
+public:
+    /**
+     * Run nbtxperwrk (or as many as the run duration allows) random lookups, insertions and removals.
+     * @param uid  Unique ID of the worker
+     * @param seed Randomness source
+    **/
+    virtual char const* run(Uid uid, Seed seed) const {
+        ::std::minstd_rand engine{seed};
+        ::std::bernoulli_distribution lookup_dist{prob_lookup};
+        ::std::bernoulli_distribution insert_dist{0.5};
+        ::std::uniform_int_distribution<size_t> key_dist{1, range};
+        begin_run(uid);
+        for (size_t cntr = 0; keep_running(uid, cntr, nbtxperwrk); ++cntr) {
+            auto key = key_dist(engine);
+            if (lookup_dist(engine)) {
+                recorded(uid, 0, [&](uint_fast64_t& retries) { return lookup_tx(key, retries); });
+            } else if (insert_dist(engine)) {
+                if (recorded(uid, 1, [&](uint_fast64_t& retries) { return insert_tx(key, retries); }))
+                    ++deltas[uid];
+            } else {
+                if (recorded(uid, 2, [&](uint_fast64_t& retries) { return remove_tx(key, retries); }))
+                    --deltas[uid];
+            }
+        }
+        return nullptr;
+    }
+    /**
+     * Test in which each worker inserts, finds and removes keys of its own, then the first one checks the invariants of the whole set.
+     * @param uid Id of the thread to run the check
+    **/
+    virtual char const* check(Uid uid, Seed seed [[gnu::unused]]) const {
+        char const* error = nullptr;
+        uint_fast64_t retries = 0;
+        barrier.sync(uid);
+        auto first = range + 1 + uid * nbcheckkeys;
+        for (auto key = first; key < first + nbcheckkeys && !error; ++key) {
+            if (unlikely(!insert_tx(key, retries)))
+                error = "Violated isolation or atomicity (private key already present)";
+            else if (unlikely(!lookup_tx(key, retries)))
+                error = "Violated consistency (inserted key not found)";
+        }
+        for (auto key = first; key < first + nbcheckkeys && !error; ++key) {
+            if (unlikely(!remove_tx(key, retries)))
+                error = "Violated consistency (inserted key not removable)";
+            else if (unlikely(lookup_tx(key, retries)))
+                error = "Violated consistency (removed key still found)";
+        }
+        barrier.sync(uid);
+        if (uid == 0 && !error) {
+            auto expected = static_cast<int_fast64_t>(nbelems);
+            for (auto delta: deltas)
+                expected += delta;
+            error = validate(static_cast<size_t>(expected));
+        }
+        return error;
+    }
+};
+
+/** Sorted linked-list set workload class: pointer chasing, and one allocation/deallocation per insertion/removal.
+**/
+class WorkloadListSet final: public WorkloadSet {
+private:
+    /** Shared list node class.
+    **/
+    class Node final {
+    private:
+        /** Dummy structure for size and alignment retrieval.
+        **/
+        struct Dummy {
+            size_t dummy0;
+            void*  dummy1;
+        };
+    public:
+        /** Get the node size.
+         * @return Node size (in bytes)
+        **/
+        constexpr static auto size() noexcept {
+            return sizeof(Dummy);
+        }
+        /** Get the node alignment.
+         * @return Node alignment (in bytes)
+        **/
+        constexpr static auto align() noexcept {
+            return alignof(Dummy);
+        }
+    private:
+        Transaction& tx; // Associated pending transaction
+    public:
+        Shared<size_t> key; // Key of the node, 0 for the head sentinel
+        Shared<Node*> next; // Next node, by increasing key (null for the last)
+    public:
+        /** Deleted copy constructor/assignment.
+        **/
+        Node(Node const&) = delete;
+        Node& operator=(Node const&) = delete;
+        /** Binding constructor.
+         * @param tx      Associated pending transaction
+         * @param address Node base address
+        **/
+        Node(Transaction& tx, void* address): tx{tx}, key{tx, address}, next{tx, key.after()} {}
+    public:
+        /** Read both fields in a single batched read.
+         * @param key  Key of the node
+         * @param next Next node
+        **/
+        void read(size_t& key, void*& next) const {
+            TransactionalMemory::Access const accesses[] = {
+                {this->key.get(), sizeof(size_t), &key},
+                {this->next.get(), sizeof(Node*), &next}
+            };
+            tx.read_batch(accesses, 2);
+        }
+    };
+    /** Locate a key in the list.
+     * @param tx   Pending transaction
+     * @param key  Key to locate
+     * @param prev Last node with a lower key (the head if none)
+     * @param curr First node with a higher or equal key (null if none)
+     * @return Whether 'curr' holds the key
+    **/
+    bool locate(Transaction& tx, size_t key, void*& prev, void*& curr) const {
+        prev = tm.get_start(); // The head sentinel is the first node of the first segment
+        curr = Node{tx, prev}.next.read();
+        while (curr) {
+            size_t curr_key;
+            void*  curr_next;
+            Node{tx, curr}.read(curr_key, curr_next);
+            if (curr_key >= key)
+                return curr_key == key;
+            prev = curr;
+            curr = curr_next;
+        }
+        return false;
+    }
+public:
+    /** List set workload constructor.
+     * @param library     Transactional library to use
+     * @param nbworkers   Total number of concurrent threads (for both 'run' and 'check')
+     * @param nbtxperwrk  Number of transactions per worker
+     * @param nbelems     Initial number of elements
+     * @param prob_lookup Probability of running a lookup transaction
+    **/
+    WorkloadListSet(TransactionalLibrary const& library, size_t nbworkers, size_t nbtxperwrk, size_t nbelems, float prob_lookup): WorkloadSet{library, Node::align(), Node::size() + sizeof(size_t), nbworkers, nbtxperwrk, nbelems, prob_lookup} {}
+private:
+    virtual bool lookup_tx(size_t key, uint_fast64_t& retries) const {
+        return transactional(tm, Transaction::Mode::read_only, [&](Transaction& tx) {
+            void* prev;
+            void* curr;
+            return locate(tx, key, prev, curr);
+        }, retries);
+    }
+    virtual bool insert_tx(size_t key, uint_fast64_t& retries) const {
+        return transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+            void* prev;
+            void* curr;
+            if (locate(tx, key, prev, curr))
+                return false;
+            Node node{tx, tx.alloc(Node::size())};
+            node.key = key;
+            node.next = reinterpret_cast<Node*>(curr);
+            Node{tx, prev}.next = reinterpret_cast<Node*>(node.key.get());
+            return true;
+        }, retries);
+    }
+    virtual bool remove_tx(size_t key, uint_fast64_t& retries) const {
+        return transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+            void* prev;
+            void* curr;
+            if (!locate(tx, key, prev, curr))
+                return false;
+            Node{tx, prev}.next = Node{tx, curr}.next.read();
+            tx.free(curr);
+            return true;
+        }, retries);
+    }
+    virtual char const* validate(size_t expected) const {
+        return transactional(tm, Transaction::Mode::read_only, [&](Transaction& tx) -> char const* {
+            size_t count = 0;
+            size_t last = 0; // Key of the head sentinel
+            void* curr = Node{tx, tm.get_start()}.next.read();
+            while (curr) {
+                size_t key;
+                Node{tx, curr}.read(key, curr);
+                if (unlikely(key <= last || key > range))
+                    return "Violated consistency (list not sorted, or with a foreign key)";
+                last = key;
+                if (unlikely(++count > expected))
+                    break;
+            }
+            if (unlikely(count != expected))
+                return "Violated isolation or atomicity (unexpected number of elements)";
+            return nullptr;
+        });
+    }
+public:
+    /**
+     * Build the initial list, once (the even keys of the range).
+    **/
+    virtual char const* init() const {
+        transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+            Node head{tx, tm.get_start()};
+            Shared<size_t> initialized{tx, head.next.after()};
+            if (initialized.read())
+                return;
+            void* prev = tm.get_start();
+            for (size_t key = 2; key <= range; key += 2) {
+                Node node{tx, tx.alloc(Node::size())};
+                node.key = key;
+                Node{tx, prev}.next = reinterpret_cast<Node*>(node.key.get());
+                prev = node.key.get();
+            }
+            initialized = 1;
+        });
+        return validate(nbelems);
+    }
+};
+
+/** Open-addressing hash map workload class: linear probing over one fixed-size table, with a checksum value per key.
+**/
+class WorkloadHashMap final: public WorkloadSet {
+private:
+    constexpr static size_t empty_key     = 0;             // Key of a never-used slot
+    constexpr static size_t tombstone_key = ~size_t{0};    // Key of a slot whose key was removed
+    size_t capbits; // Log2 of the number of slots
+    /** Get the table capacity for a given number of keys.
+     * @param nbkeys Number of keys that may be inserted
+     * @return Log2 of the number of slots, at least 4 per key
+    **/
+    static size_t capbits_for(size_t nbkeys) noexcept {
+        size_t bits = 2;
+        while ((size_t{1} << bits) < 4 * nbkeys)
+            ++bits;
+        return bits;
+    }
+    /** Get the value every key must be mapped to.
+     * @param key Key
+     * @return Checksum value of the key
+    **/
+    static size_t checksum(size_t key) noexcept {
+        return key * 0x2545F4914F6CDD1Dul;
+    }
+    /** Get a slot's key.
+     * @param tx   Pending transaction
+     * @param slot Slot index
+     * @return Shared key of that slot
+    **/
+    Shared<size_t> slot_key(Transaction& tx, size_t slot) const {
+        return Shared<size_t>{tx, reinterpret_cast<size_t*>(tm.get_start()) + 2 * slot};
+    }
+    /** Probe the table for a key.
+     * @param tx   Pending transaction
+     * @param key  Key to look for
+     * @param slot Slot holding the key if found, first reusable slot on its probe sequence otherwise (capacity if none)
+     * @return Whether the key was found
+    **/
+    bool probe(Transaction& tx, size_t key, size_t& slot) const {
+        auto const capacity = size_t{1} << capbits;
+        auto const start = static_cast<size_t>((key * 0x9E3779B97F4A7C15ul) >> (64 - capbits));
+        slot = capacity;
+        for (size_t i = 0; i < capacity; ++i) {
+            auto index = (start + i) & (capacity - 1);
+            auto current = slot_key(tx, index).read();
+            if (current == key) {
+                slot = index;
+                return true;
+            }
+            if (current == tombstone_key && slot == capacity) {
+                slot = index;
+            } else if (current == empty_key) {
+                if (slot == capacity)
+                    slot = index;
+                return false;
+            }
+        }
+        return false;
+    }
+public:
+    /** Hash map workload constructor.
+     * @param library     Transactional library to use
+     * @param nbworkers   Total number of concurrent threads (for both 'run' and 'check')
+     * @param nbtxperwrk  Number of transactions per worker
+     * @param nbelems     Initial number of elements
+     * @param prob_lookup Probability of running a lookup transaction
+    **/
+    WorkloadHashMap(TransactionalLibrary const& library, size_t nbworkers, size_t nbtxperwrk, size_t nbelems, float prob_lookup): WorkloadSet{library, alignof(size_t), (2 * sizeof(size_t) << capbits_for(2 * nbelems + nbworkers * nbcheckkeys)) + sizeof(size_t), nbworkers, nbtxperwrk, nbelems, prob_lookup}, capbits{capbits_for(2 * nbelems + nbworkers * nbcheckkeys)} {}
+private:
+    virtual bool lookup_tx(size_t key, uint_fast64_t& retries) const {
+        return transactional(tm, Transaction::Mode::read_only, [&](Transaction& tx) {
+            size_t slot;
+            return probe(tx, key, slot);
+        }, retries);
+    }
+    virtual bool insert_tx(size_t key, uint_fast64_t& retries) const {
+        return transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+            size_t slot;
+            if (probe(tx, key, slot) || unlikely(slot == (size_t{1} << capbits))) // Present, or no reusable slot left
+                return false;
+            auto value = checksum(key);
+            auto target = slot_key(tx, slot).get();
+            TransactionalMemory::Access const accesses[] = {
+                {&key, sizeof(size_t), target},
+                {&value, sizeof(size_t), target + 1}
+            };
+            tx.write_batch(accesses, 2);
+            return true;
+        }, retries);
+    }
+    virtual bool remove_tx(size_t key, uint_fast64_t& retries) const {
+        return transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+            size_t slot;
+            if (!probe(tx, key, slot))
+                return false;
+            slot_key(tx, slot) = tombstone_key;
+            return true;
+        }, retries);
+    }
+    virtual char const* validate(size_t expected) const {
+        return transactional(tm, Transaction::Mode::read_only, [&](Transaction& tx) -> char const* {
+            auto const capacity = size_t{1} << capbits;
+            ::std::vector<bool> seen(range + 1, false);
+            size_t count = 0;
+            for (size_t slot = 0; slot < capacity; ++slot) {
+                size_t key;
+                size_t value;
+                auto source = slot_key(tx, slot).get();
+                TransactionalMemory::Access const accesses[] = {
+                    {source, sizeof(size_t), &key},
+                    {source + 1, sizeof(size_t), &value}
+                };
+                tx.read_batch(accesses, 2);
+                if (key == empty_key || key == tombstone_key)
+                    continue;
+                if (unlikely(key > range || seen[key]))
+                    return "Violated consistency (duplicated or foreign key)";
+                if (unlikely(value != checksum(key)))
+                    return "Violated isolation or atomicity (key and value out of sync)";
+                seen[key] = true;
+                ++count;
+            }
+            if (unlikely(count != expected))
+                return "Violated isolation or atomicity (unexpected number of elements)";
+            return nullptr;
+        });
+    }
+public:
+    /**
+     * Fill the initial table, once (the even keys of the range).
+    **/
+    virtual char const* init() const {
+        transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+            Shared<size_t> initialized{tx, reinterpret_cast<size_t*>(tm.get_start()) + (size_t{2} << capbits)};
+            if (initialized.read())
+                return;
+            for (size_t key = 2; key <= range; key += 2) {
+                size_t slot;
+                probe(tx, key, slot);
+                slot_key(tx, slot) = key;
+                Shared<size_t>{tx, slot_key(tx, slot).get() + 1} = checksum(key);
+            }
+            initialized = 1;
+        });
+        return validate(nbelems);
+    }
+};
@@ -0,0 +1,59 @@
+/**
+ * @file   tm-ext.h
+ *
+ * @section DESCRIPTION
+ *
+ * Optional extensions of the transaction manager interface (C version).
+ * A library may export any of these symbols on top of the ones of 'tm.h'; the
+ * grading harness looks them up, and falls back on the base interface for the
+ * ones that are missing.
+ **/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <tm.h>
+
+// -------------------------------------------------------------------------- //
+
+// One range access of a batch, with the arguments of one tm_read/tm_write
+typedef struct {
+    void const *source;  // Source start address
+    size_t size;         // Length to copy (in bytes)
+    void *target;        // Target start address
+} tm_access_t;
+
+// Statistics of a shared memory region, summed over the threads using it
+typedef struct {
+    uint64_t commits;             // Committed transactions (all kinds)
+    uint64_t ro_commits;          // Committed read-only transactions
+    uint64_t htm_commits;         // Read-write transactions committed in hardware
+    uint64_t htm_fallbacks;       // Read-write transactions run in software instead
+    uint64_t aborts_read;         // Aborts reading a word written by another transaction
+    uint64_t aborts_write;        // Aborts writing a word accessed by another transaction
+    uint64_t aborts_alloc;        // Aborts (de)allocating
+    uint64_t epochs;              // Ended epochs (batches of transactions)
+    uint64_t epoch_transactions;  // Read-write transactions over the ended epochs
+    uint64_t batcher_wait_ns;     // Time spent waiting to enter an epoch (in ns)
+} tm_stats_t;
+
+// -------------------------------------------------------------------------- //
+
+bool tm_read_batch(shared_t, tx_t, tm_access_t const *, size_t);
+
+bool tm_write_batch(shared_t, tx_t, tm_access_t const *, size_t);
+
+void tm_stats(shared_t, tm_stats_t *);
+
+// Write the live segments into a file (at an epoch end), and create a region
+// back from such a file, where the same addresses hold the same data
+bool tm_checkpoint(shared_t, char const *);
+
+shared_t tm_restore(char const *);
+
+// Add to a 64-bit integer of the shared region without reading it; adds of
+// concurrent transactions commute, and need not conflict with each other
+bool tm_add(shared_t, tx_t, void *, int64_t);
@@ -18,60 +18,126 @@
  *
  * @section DESCRIPTION
  *
- * "Entry point" source file, implementing the playground function 'entry_point' and the lock.
+ * "Entry point" source file, implementing the playground function 'entry_point' and the locks.
 **/
 
 // External headers
 #include <atomic>
-#include <iostream>
+#include <exception>
 #include <mutex>
+#include <thread>
 
 // Internal headers
 #include "entrypoint.hpp"
 #include "runner.hpp"
 
 // -------------------------------------------------------------------------- //
-// Lock implementation, that you have to complete
+// Waiting helper
 
-// NOTE: You may want to add data member(s) in 'class Lock' at entrypoint.hpp:30
+/** Wait a bit before polling again, yielding the processor once in a while (in case the awaited thread is preempted).
+ * @param spins Number of polls so far, incremented
+**/
+static void spin_wait(size_t& spins) {
+    if (++spins % 1024 == 0) {
+        ::std::this_thread::yield();
+        return;
+    }
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+// MCS lock implementation
+
+/** Maximum number of MCS locks a thread can hold or await at once.
+**/
+constexpr static size_t max_held = 8;
+
+/** Queue nodes of this thread.
+**/
+static thread_local McsLock::Node nodes[max_held];
 
 /** Lock default constructor.
 **/
-Lock::Lock() {
-    // ...
+McsLock::McsLock(): tail{nullptr}, owner{nullptr} {}
+
+/** [thread-safe] Acquire the lock, block if it is already acquired.
+**/
+void McsLock::lock() {
+    Node* node = nodes;
+    while (node->busy) { // Take a free node of this thread
+        if (++node == nodes + max_held)
+            ::std::terminate(); // Too many locks held at once
+    }
+    node->busy = true;
+    node->next.store(nullptr, ::std::memory_order_relaxed);
+    node->locked.store(true, ::std::memory_order_relaxed);
+    auto prev = tail.exchange(node, ::std::memory_order_acq_rel);
+    if (prev) { // Queue behind the previous waiter, then wait for it to hand the lock over
+        prev->next.store(node, ::std::memory_order_release);
+        size_t spins = 0;
+        while (node->locked.load(::std::memory_order_acquire))
+            spin_wait(spins);
+    }
+    owner = node;
 }
 
-/** Lock destructor.
+/** [thread-safe] Release the lock, assuming it is indeed held by the caller.
 **/
-Lock::~Lock() {
-    // ...
+void McsLock::unlock() {
+    auto node = owner; // Read before the hand-over, the next holder overwrites it
+    auto next = node->next.load(::std::memory_order_acquire);
+    if (!next) {
+        auto expected = node;
+        if (tail.compare_exchange_strong(expected, nullptr, ::std::memory_order_release, ::std::memory_order_relaxed)) { // No waiter
+            node->busy = false;
+            return;
+        }
+        size_t spins = 0;
+        while (!(next = node->next.load(::std::memory_order_acquire))) // A waiter is enqueuing itself
+            spin_wait(spins);
+    }
+    next->locked.store(false, ::std::memory_order_release);
+    node->busy = false;
 }
 
+// -------------------------------------------------------------------------- //
+// Ticket lock implementation
+
+/** Lock default constructor.
+**/
+TicketLock::TicketLock(): next{0}, serving{0} {}
+
 /** [thread-safe] Acquire the lock, block if it is already acquired.
 **/
-void Lock::lock() {
-    // ...
+void TicketLock::lock() {
+    auto ticket = next.fetch_add(1, ::std::memory_order_relaxed);
+    size_t spins = 0;
+    while (serving.load(::std::memory_order_acquire) != ticket)
+        spin_wait(spins);
 }
 
 /** [thread-safe] Release the lock, assuming it is indeed held by the caller.
 **/
-void Lock::unlock() {
-    // ...
+void TicketLock::unlock() {
+    serving.store(serving.load(::std::memory_order_relaxed) + 1, ::std::memory_order_release);
 }
 
 // -------------------------------------------------------------------------- //
 // Thread accessing the shared memory (a mere shared counter in this program)
 
 /** Thread entry point.
- * @param nb   Total number of threads
- * @param id   This thread ID (from 0 to nb-1 included)
- * @param lock Lock to use to protect the shared memory (read & written by 'shared_access')
+ * @param count Number of accesses to make
+ * @param lock  Lock to use to protect the shared memory (read & written by 'shared_access')
 **/
-void entry_point(size_t nb, size_t id, Lock& lock) {
-    ::printf("Hello from thread %lu/%lu\n", id, nb);
-    for (int i = 0; i < 10000; ++i) {
+template<class Lock> void entry_point(size_t, size_t, size_t count, Lock& lock) {
+    for (size_t i = 0; i < count; ++i) {
         ::std::lock_guard<Lock> guard{lock}; // Lock is acquired here
         ::shared_access();
         // Lock is automatically released here (thanks to 'lock_guard', upon leaving the scope)
     }
 }
+
+template void entry_point(size_t, size_t, size_t, McsLock&);
+template void entry_point(size_t, size_t, size_t, TicketLock&);
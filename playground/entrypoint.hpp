@@ -23,26 +23,86 @@
 
 #pragma once
 
+// External headers
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
 // -------------------------------------------------------------------------- //
 
-/** Your lock class.
+// Lock variant behind 'Lock' (build with -DTICKET_LOCK=1 for the ticket lock):
+// the MCS lock by default, where each waiter spins on its own queue node, so a
+// release only invalidates the line of the next waiter's node.
+#ifndef TICKET_LOCK
+#define TICKET_LOCK 0
+#endif
+
+/** MCS queue lock class, each waiting thread spinning on a node of its own.
+**/
+class McsLock final {
+public:
+    /** Queue node class, one per (thread, held or awaited lock).
+    **/
+    struct alignas(64) Node {
+        ::std::atomic<Node*> next; // Next waiter in the queue
+        ::std::atomic<bool> locked; // Whether the owner of this node still waits
+        bool busy; // Whether the node is in use by its (thread-local) owner
+    };
+private:
+    alignas(64) ::std::atomic<Node*> tail; // Last node in the queue, null if the lock is free
+    Node* owner; // Node of the holder (only accessed by the holder)
+public:
+    /** Deleted copy/move constructor/assignment.
+    **/
+    McsLock(McsLock const&) = delete;
+    McsLock& operator=(McsLock const&) = delete;
+public:
+    McsLock();
+public:
+    void lock();
+    void unlock();
+public:
+    /** Get the name of the variant.
+     * @return Constant null-terminated name
+    **/
+    constexpr static char const* name() noexcept {
+        return "mcs";
+    }
+};
+
+/** Ticket lock class, threads being served in the order they took their tickets.
 **/
-class Lock final {
+class TicketLock final {
+private:
+    alignas(64) ::std::atomic<uint_fast32_t> next; // Next ticket to hand out
+    alignas(64) ::std::atomic<uint_fast32_t> serving; // Ticket currently served
 public:
     /** Deleted copy/move constructor/assignment.
     **/
-    Lock(Lock const&) = delete;
-    Lock& operator=(Lock const&) = delete;
-    // NOTE: Actually, one could argue it makes sense to implement move,
-    //       but we don't care about this feature in our simple playground
+    TicketLock(TicketLock const&) = delete;
+    TicketLock& operator=(TicketLock const&) = delete;
 public:
-    Lock();
-    ~Lock();
+    TicketLock();
 public:
     void lock();
     void unlock();
+public:
+    /** Get the name of the variant.
+     * @return Constant null-terminated name
+    **/
+    constexpr static char const* name() noexcept {
+        return "ticket";
+    }
 };
 
+/** Lock class, selected at build time.
+**/
+#if TICKET_LOCK
+using Lock = TicketLock;
+#else
+using Lock = McsLock;
+#endif
+
 // -------------------------------------------------------------------------- //
 
-void entry_point(size_t, size_t, Lock&);
+template<class Lock> void entry_point(size_t, size_t, size_t, Lock&);
@@ -23,8 +23,11 @@
 
 // External headers
 #include <atomic>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
 #include <thread>
+#include <vector>
 
 // Internal headers
 #include "entrypoint.hpp"
@@ -43,20 +46,50 @@ void shared_access() {
     check_counter.fetch_add(1, ::std::memory_order_relaxed);
 }
 
-/** (Empirically) checks that concurrent operations did not break consistency, warn accordingly.
+/** (Empirically) checks that concurrent operations did not break consistency, then reset the shared memory.
+ * @return Whether no inconsistency was detected
 **/
-static void shared_check() {
+static bool shared_check() {
     auto calls = check_counter.load(::std::memory_order_relaxed);
-    if (counter == calls) {
-        ::std::cout << "** No inconsistency detected (" << counter << " == " << calls << ") **" << ::std::endl;
-    } else {
-        ::std::cout << "** Inconsistency detected (" << counter << " != " << calls << ") **" << ::std::endl;
-    }
+    auto res = counter == calls;
+    counter = 0;
+    check_counter.store(0, ::std::memory_order_relaxed);
+    return res;
 }
 
 // -------------------------------------------------------------------------- //
 // Lock + thread launches and management
 
+/** Number of accesses made by each thread.
+**/
+constexpr static size_t nbaccesses = 100000;
+
+/** Time the accesses of the given number of threads under a lock variant, warn on inconsistency.
+ * @param nbthreads Number of threads
+ * @return Whether no inconsistency was detected
+**/
+template<class Lock> static bool bench(size_t nbthreads) {
+    Lock lock;
+    ::std::atomic<bool> go{false};
+    ::std::vector<::std::thread> threads;
+    threads.reserve(nbthreads);
+    for (size_t i = 0; i < nbthreads; ++i) {
+        threads.emplace_back([&](size_t i) {
+            while (!go.load(::std::memory_order_acquire))
+                ::std::this_thread::yield();
+            entry_point(nbthreads, i, nbaccesses, lock);
+        }, i);
+    }
+    auto start = ::std::chrono::steady_clock::now(); // Every thread starts at once, their creation is not timed
+    go.store(true, ::std::memory_order_release);
+    for (auto&& thread: threads)
+        thread.join();
+    auto const elapsed = ::std::chrono::duration<double, ::std::nano>{::std::chrono::steady_clock::now() - start}.count();
+    auto res = shared_check();
+    ::std::cout << ::std::setw(6) << Lock::name() << " | " << ::std::setw(7) << nbthreads << " | " << ::std::setw(9) << ::std::fixed << ::std::setprecision(2) << elapsed / 1e6 << " | " << ::std::setw(9) << elapsed / static_cast<double>(nbthreads * nbaccesses) << " | " << (res ? "ok" : "INCONSISTENT") << ::std::endl;
+    return res;
+}
+
 /** Program entry point.
  * @param argc Arguments count
  * @param argv Arguments values
@@ -71,15 +104,19 @@ int main(int, char**) {
         }
         return static_cast<size_t>(res);
     }();
-    Lock lock;
-    ::std::thread threads[nbworkers];
-    for (size_t i = 0; i < nbworkers; ++i) {
-        threads[i] = ::std::thread{[&](size_t i) {
-            entry_point(nbworkers, i, lock);
-        }, i};
+    ::std::vector<size_t> counts; // 1, 2, 4, ... up to (and including) the number of hardware threads
+    for (size_t count = 1; count < nbworkers; count *= 2)
+        counts.push_back(count);
+    counts.push_back(nbworkers);
+    ::std::cout << "(" << Lock::name() << " lock, selected at build time, " << nbaccesses << " accesses per thread)" << ::std::endl;
+    ::std::cout << "  lock | threads | time (ms) | ns/access | check" << ::std::endl;
+    auto consistent = true;
+    for (auto count: counts)
+        consistent &= bench<Lock>(count);
+    if (consistent) {
+        ::std::cout << "** No inconsistency detected **" << ::std::endl;
+    } else {
+        ::std::cout << "** Inconsistency detected **" << ::std::endl;
     }
-    for (auto&& thread: threads)
-        thread.join();
-    shared_check();
-    return 0;
+    return consistent ? 0 : 1;
 }
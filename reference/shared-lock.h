@@ -1,22 +1,39 @@
 #pragma once
 
-// Requested feature: pthread_rwlock_t
+// Requested feature: sched_yield
 #ifndef _GNU_SOURCE
 #define _GNU_SOURCE
 #endif
-#ifndef __USE_XOPEN2K
-#define __USE_XOPEN2K
-#endif
 
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+// number of reader slots of a shared lock, and their stride (a cache line, so
+// that no two slots ever share one)
+#define SHARED_LOCK_SLOTS 64
+#define SHARED_LOCK_SLOT_SIZE 64
+
+/**
+ * @brief One reader slot: the number of readers (mapped on it) holding the
+ * lock, alone on its cache line.
+ */
+struct shared_lock_slot_t {
+    atomic_size_t readers;
+    char padding[SHARED_LOCK_SLOT_SIZE - sizeof(atomic_size_t)];
+};
 
 /**
  * @brief A lock that can be taken exclusively but also shared. Contrarily to
  * exclusive locks, shared locks do not have wait/wake_up capabilities.
+ * Readers are spread over per-thread slots so that they don't all update the
+ * same cache line; a waiting writer holds back new readers (writer preference).
  */
 struct shared_lock_t {
-    pthread_rwlock_t rwlock;
+    struct shared_lock_slot_t slots[SHARED_LOCK_SLOTS];
+    atomic_bool writer;       // a writer holds or waits for the lock
+    pthread_mutex_t writers;  // serializes writers
 };
 
 /** Initialize the given lock.
@@ -0,0 +1,747 @@
+/**
+ * @file   tm.c
+ * @author [...]
+ *
+ * @section LICENSE
+ *
+ * [...]
+ *
+ * @section DESCRIPTION
+ *
+ * Striped lock-based transaction manager, a stronger baseline than the global
+ * lock of the reference: every word is mapped (by address, a 64-byte block
+ * per stripe) onto a stripe guarded by a reader-writer lock, taken at the word's first access and held
+ * until the end of the transaction (two-phase locking), with writes done in
+ * place and undone from a log on abort.
+ **/
+
+// Requested features
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#ifdef __STDC_NO_ATOMICS__
+#error Current C11 compiler does not support atomic operations
+#endif
+
+// External headers
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Internal headers
+#include <tm.h>
+
+#include "lock.h"
+#include "macros.h"
+
+// Each word of the shared memory is mapped (by address) onto one of a fixed
+// number of stripes, each protected by a reader-writer lock:
+// - STRIPE_WRITER:  held exclusively by one transaction
+// - otherwise:      the number of transactions sharing it (0 if free), plus
+//   STRIPE_PENDING: a transaction waits for them to leave to hold it
+//                   exclusively, no other one can share it meanwhile (else a
+//                   stripe always shared by someone could never be written)
+typedef _Atomic(uint64_t) stripe_lock_t;
+#define STRIPE_COUNT ((size_t) 1 << 20)
+#define STRIPE_GRAIN_SHIFT 6  // a stripe covers (at least) a 64-byte block
+static const uint64_t STRIPE_WRITER = UINT64_C(1) << 63;
+static const uint64_t STRIPE_PENDING = UINT64_C(1) << 62;
+
+// Deadlock avoidance: a transaction only waits for a stripe placed (in the
+// table) after every stripe it holds, so that no cycle of waiters can form.
+// A stripe placed before (or already shared, to be held exclusively) is only
+// tried that many times, then the transaction aborts, to retry after a
+// randomized backoff. Waiters yield once in a while, as the holder may not be
+// running.
+#define STRIPE_TRIES 256
+#define STRIPE_SPINS 16
+#define BACKOFF_MAX_SHIFT 12
+
+typedef struct vector_t {  // growable array of fixed-size items
+    char *items;
+    size_t size;
+    size_t capacity;
+    size_t item_size;
+} vector_t;
+
+static void vector_init(vector_t *vector, size_t item_size) {
+  vector->items = NULL;
+  vector->size = 0;
+  vector->capacity = 0;
+  vector->item_size = item_size;
+}
+
+/** Append an (uninitialized) item to the vector.
+ * @param vector Vector to grow
+ * @return Address of the new item, NULL on allocation failure
+ **/
+static void *vector_push(vector_t *vector) {
+  if (unlikely(vector->size == vector->capacity)) {
+    size_t capacity = vector->capacity ? vector->capacity * 2 : 16;
+    char *items = realloc(vector->items, capacity * vector->item_size);
+    if (unlikely(!items)) {
+      return NULL;
+    }
+    vector->items = items;
+    vector->capacity = capacity;
+  }
+  return vector->items + vector->size++ * vector->item_size;
+}
+
+static inline void *vector_get(vector_t const *vector, size_t index) {
+  return vector->items + index * vector->item_size;
+}
+
+typedef struct held_t {
+    stripe_lock_t *lock;  // stripe held
+    size_t index_slot;    // slot of the entry in the held stripes' index
+    bool exclusive;       // whether it is held exclusively
+} held_t;
+
+/**
+ * @brief Allocated segments are linked together (by a header placed before
+ * their first word) so that the region can release the remaining ones.
+ */
+typedef struct segment_node_t {
+    struct segment_node_t *prev;
+    struct segment_node_t *next;
+} segment_node_t;
+
+/**
+ * @brief Per-thread transaction descriptor, reused by every transaction the
+ * thread runs on the region.
+ */
+typedef struct transaction_t {
+    vector_t held;            // held_t, stripes in acquisition order
+    stripe_lock_t *highest;   // stripe placed last among the held ones
+    // open-addressing index (by stripe) of the held stripes: entry index + 1,
+    // 0 for an empty slot
+    size_t *index;
+    size_t index_capacity;
+    vector_t undo_words;      // void*, words written in place, in order
+    vector_t undo_values;     // one word per written word, its prior content
+    vector_t allocated;       // segment_node_t*, released if aborting
+    vector_t freed;           // segment_node_t*, released if committing
+    unsigned int aborts;      // consecutive aborts, for the backoff
+    uint64_t seed;            // backoff randomness
+    void const *owner;           // thread of the descriptor (its cache's address)
+    struct transaction_t *next;  // descriptors of the region
+} transaction_t;
+
+typedef struct shared_region_t {
+    stripe_lock_t *locks;     // STRIPE_COUNT stripes
+    _Atomic(transaction_t *) descriptors;
+    struct lock_t segments_lock;  // protects the list of segments
+    segment_node_t *segments;
+    uint64_t uid;
+    void *start;
+    size_t size;
+    size_t alignment;
+    size_t header_size;  // segment header, keeping the words aligned
+    int stripe_shift;  // log2 of the bytes covered by a stripe
+} shared_region_t;
+
+static _Atomic(uint64_t) regions_counter = 1;
+
+// each thread caches its descriptor of the region it last used; a region is
+// identified by a unique id, as its address may be reused once destroyed
+static _Thread_local struct {
+    uint64_t region_uid;
+    transaction_t *descriptor;
+} descriptor_cache;
+
+static inline stripe_lock_t *get_lock(shared_region_t const *region,
+  void const *word) {
+  uintptr_t index = (uintptr_t) word >> region->stripe_shift;
+  // spread consecutive words of unrelated segments over the whole table
+  index ^= index >> 20;
+  return &(region->locks[index & (STRIPE_COUNT - 1)]);
+}
+
+static inline void *segment_words(shared_region_t const *region,
+  segment_node_t *node) {
+  return (void *) ((uintptr_t) node + region->header_size);
+}
+
+static inline segment_node_t *segment_node(shared_region_t const *region,
+  void *words) {
+  return (segment_node_t *) ((uintptr_t) words - region->header_size);
+}
+
+static inline void cpu_relax(void) {
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#endif
+}
+
+/** Wait a bit before trying a stripe (or a transaction) again.
+ * @param tries Number of tries so far
+ **/
+static inline void stripe_wait(size_t tries) {
+  if (tries % STRIPE_SPINS == 0) {
+    sched_yield();
+  } else {
+    cpu_relax();
+  }
+}
+
+/** Release a segment that no transaction can access anymore.
+ * @param region Shared memory region
+ * @param node   Segment to release
+ **/
+static void segment_release(shared_region_t *region, segment_node_t *node) {
+  lock_acquire(&(region->segments_lock));
+  if (node->prev) {
+    node->prev->next = node->next;
+  } else {
+    region->segments = node->next;
+  }
+  if (node->next) {
+    node->next->prev = node->prev;
+  }
+  lock_release(&(region->segments_lock));
+  free(node);
+}
+
+/** Create (i.e. allocate + init) a new shared memory region, with one first
+ *non-free-able allocated segment of the requested size and alignment.
+ * @param size  Size of the first shared segment of memory to allocate (in
+ *bytes), must be a positive multiple of the alignment
+ * @param align Alignment (in bytes, must be a power of 2) that the shared
+ *memory region must support
+ * @return Opaque shared memory region handle, 'invalid_shared' on failure
+ **/
+shared_t tm_create(size_t size, size_t align) {
+  shared_region_t *region = malloc(sizeof(shared_region_t));
+  if (unlikely(!region)) {
+    return invalid_shared;
+  }
+  region->locks = calloc(STRIPE_COUNT, sizeof(stripe_lock_t));
+  if (unlikely(!region->locks)) {
+    free(region);
+    return invalid_shared;
+  }
+  if (unlikely(!lock_init(&(region->segments_lock)))) {
+    free(region->locks);
+    free(region);
+    return invalid_shared;
+  }
+  size_t header_align = align < sizeof(void *) ? sizeof(void *) : align;
+  region->header_size = (sizeof(segment_node_t) + header_align - 1)
+    / header_align * header_align;
+  segment_node_t *node;
+  if (unlikely(posix_memalign((void **) &node, header_align,
+    region->header_size + size) != 0)) {
+    lock_cleanup(&(region->segments_lock));
+    free(region->locks);
+    free(region);
+    return invalid_shared;
+  }
+  node->prev = NULL;
+  node->next = NULL;
+  region->segments = node;
+  region->start = segment_words(region, node);
+  memset(region->start, 0, size);
+  atomic_init(&(region->descriptors), NULL);
+  region->uid = atomic_fetch_add(&regions_counter, 1);
+  region->size = size;
+  region->alignment = align;
+  region->stripe_shift = __builtin_ctzl(align) > STRIPE_GRAIN_SHIFT
+    ? __builtin_ctzl(align) : STRIPE_GRAIN_SHIFT;
+  return region;
+}
+
+/** Destroy (i.e. clean-up + free) a given shared memory region.
+ * @param shared Shared memory region to destroy, with no running transaction
+ **/
+void tm_destroy(shared_t shared) {
+  shared_region_t *region = (shared_region_t *) shared;
+  transaction_t *descriptor = atomic_load(&(region->descriptors));
+  while (descriptor) {
+    transaction_t *next = descriptor->next;
+    free(descriptor->held.items);
+    free(descriptor->index);
+    free(descriptor->undo_words.items);
+    free(descriptor->undo_values.items);
+    free(descriptor->allocated.items);
+    free(descriptor->freed.items);
+    free(descriptor);
+    descriptor = next;
+  }
+  while (region->segments) {
+    segment_node_t *next = region->segments->next;
+    free(region->segments);
+    region->segments = next;
+  }
+  lock_cleanup(&(region->segments_lock));
+  free(region->locks);
+  free(region);
+}
+
+/** [thread-safe] Return the start address of the first allocated segment in
+ *the shared memory region.
+ * @param shared Shared memory region to query
+ * @return Start address of the first allocated segment
+ **/
+void *tm_start(shared_t shared) {
+  return ((shared_region_t *) shared)->start;
+}
+
+/** [thread-safe] Return the size (in bytes) of the first allocated segment of
+ *the shared memory region.
+ * @param shared Shared memory region to query
+ * @return First allocated segment size
+ **/
+size_t tm_size(shared_t shared) {
+  return ((shared_region_t *) shared)->size;
+}
+
+/** [thread-safe] Return the alignment (in bytes) of the memory accesses on
+ *the given shared memory region.
+ * @param shared Shared memory region to query
+ * @return Alignment used globally
+ **/
+size_t tm_align(shared_t shared) {
+  return ((shared_region_t *) shared)->alignment;
+}
+
+/** Get the calling thread's descriptor of the region, registering one on the
+ *thread's first transaction.
+ * @param region Shared memory region
+ * @return Descriptor, NULL on allocation failure
+ **/
+static transaction_t *get_descriptor(shared_region_t *region) {
+  if (likely(descriptor_cache.region_uid == region->uid)) {
+    return descriptor_cache.descriptor;
+  }
+  void const *owner = &descriptor_cache;
+  transaction_t *descriptor;
+  // a thread switching regions already has one (only it can register it)
+  for (descriptor = atomic_load(&(region->descriptors)); descriptor;
+    descriptor = descriptor->next) {
+    if (descriptor->owner == owner) {
+      descriptor_cache.region_uid = region->uid;
+      descriptor_cache.descriptor = descriptor;
+      return descriptor;
+    }
+  }
+  descriptor = malloc(sizeof(transaction_t));
+  if (unlikely(!descriptor)) {
+    return NULL;
+  }
+  descriptor->owner = owner;
+  vector_init(&(descriptor->held), sizeof(held_t));
+  descriptor->highest = NULL;
+  descriptor->index = NULL;
+  descriptor->index_capacity = 0;
+  vector_init(&(descriptor->undo_words), sizeof(void *));
+  vector_init(&(descriptor->undo_values), region->alignment);
+  vector_init(&(descriptor->allocated), sizeof(segment_node_t *));
+  vector_init(&(descriptor->freed), sizeof(segment_node_t *));
+  descriptor->aborts = 0;
+  descriptor->seed = (uintptr_t) descriptor | 1;
+  descriptor->next = atomic_load(&(region->descriptors));
+  while (!atomic_compare_exchange_weak(&(region->descriptors),
+    &(descriptor->next), descriptor)) {}
+  descriptor_cache.region_uid = region->uid;
+  descriptor_cache.descriptor = descriptor;
+  return descriptor;
+}
+
+/** [thread-safe] Begin a new transaction on the given shared memory region.
+ * @param shared Shared memory region to start a transaction on
+ * @param is_ro  Whether the transaction is read-only
+ * @return Opaque transaction ID, 'invalid_tx' on failure
+ **/
+tx_t tm_begin(shared_t shared, bool unused(is_ro)) {
+  // read-only transactions only ever take stripes in shared mode
+  transaction_t *transaction = get_descriptor((shared_region_t *) shared);
+  if (unlikely(!transaction)) {
+    return invalid_tx;
+  }
+  return (tx_t) transaction;
+}
+
+/** Release every stripe the transaction holds and clear its logs.
+ * @param transaction Ending transaction
+ **/
+static void finish(transaction_t *transaction) {
+  for (size_t i = 0; i < transaction->held.size; i++) {
+    held_t *held = vector_get(&(transaction->held), i);
+    if (held->exclusive) {
+      atomic_store_explicit(held->lock, 0, memory_order_release);
+    } else {
+      atomic_fetch_sub_explicit(held->lock, 1, memory_order_release);
+    }
+    transaction->index[held->index_slot] = 0;
+  }
+  transaction->held.size = 0;
+  transaction->highest = NULL;
+  transaction->undo_words.size = 0;
+  transaction->undo_values.size = 0;
+  transaction->allocated.size = 0;
+  transaction->freed.size = 0;
+}
+
+/** Abort the transaction: restore the words it wrote (last write first),
+ *release the segments it allocated (their addresses were never published,
+ *the words that held them being restored), release its stripes, then back
+ *off for a random time, longer after each consecutive abort.
+ * @param region      Shared memory region
+ * @param transaction Aborting transaction
+ **/
+static void abort_transaction(shared_region_t *region,
+  transaction_t *transaction) {
+  for (size_t i = transaction->undo_words.size; i-- > 0;) {
+    memcpy(*(void **) vector_get(&(transaction->undo_words), i),
+      vector_get(&(transaction->undo_values), i), region->alignment);
+  }
+  for (size_t i = 0; i < transaction->allocated.size; i++) {
+    segment_release(region,
+      *(segment_node_t **) vector_get(&(transaction->allocated), i));
+  }
+  finish(transaction);
+  unsigned int shift = transaction->aborts < BACKOFF_MAX_SHIFT
+    ? ++transaction->aborts : BACKOFF_MAX_SHIFT;
+  transaction->seed ^= transaction->seed << 13;  // xorshift64
+  transaction->seed ^= transaction->seed >> 7;
+  transaction->seed ^= transaction->seed << 17;
+  for (uint64_t spins = transaction->seed & ((UINT64_C(1) << shift) - 1);
+    spins > 0; spins--) {
+    stripe_wait(spins);
+  }
+}
+
+/** [thread-safe] End the given transaction.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to end
+ * @return Whether the whole transaction committed
+ **/
+bool tm_end(shared_t shared, tx_t tx) {
+  shared_region_t *region = (shared_region_t *) shared;
+  transaction_t *transaction = (transaction_t *) tx;
+  // the stripes of the words that held the freed segments' addresses are
+  // still held: no other transaction can be on its way to these segments
+  for (size_t i = 0; i < transaction->freed.size; i++) {
+    segment_release(region,
+      *(segment_node_t **) vector_get(&(transaction->freed), i));
+  }
+  finish(transaction);
+  transaction->aborts = 0;
+  return true;
+}
+
+static inline size_t index_hash(stripe_lock_t const *lock, size_t capacity) {
+  uint64_t hash = ((uintptr_t) lock / sizeof(stripe_lock_t))
+    * UINT64_C(0x9e3779b97f4a7c15);
+  return (size_t) (hash >> 32) & (capacity - 1);
+}
+
+/** Find the held entry of a stripe.
+ * @param transaction Transaction to search the held stripes of
+ * @param lock        Stripe
+ * @return Index of the entry, the number of held stripes if none
+ **/
+static size_t find_held(transaction_t const *transaction,
+  stripe_lock_t const *lock) {
+  if (transaction->held.size == 0) {
+    return 0;
+  }
+  size_t mask = transaction->index_capacity - 1;
+  for (size_t slot = index_hash(lock, transaction->index_capacity);;
+    slot = (slot + 1) & mask) {
+    size_t entry = transaction->index[slot];
+    if (entry == 0) {
+      return transaction->held.size;
+    }
+    if (((held_t *) vector_get(&(transaction->held), entry - 1))->lock
+      == lock) {
+      return entry - 1;
+    }
+  }
+}
+
+/** Place an entry in the held stripes' index, slot by linear probing.
+ * @param transaction Transaction owning the index
+ * @param entry       Index of the entry, not in the index yet
+ **/
+static void index_insert(transaction_t *transaction, size_t entry) {
+  held_t *held = vector_get(&(transaction->held), entry);
+  size_t mask = transaction->index_capacity - 1;
+  size_t slot = index_hash(held->lock, transaction->index_capacity);
+  while (transaction->index[slot] != 0) {
+    slot = (slot + 1) & mask;
+  }
+  transaction->index[slot] = entry + 1;
+  held->index_slot = slot;
+}
+
+/** Make room in the held stripes' index for one more entry (at most half
+ *full).
+ * @param transaction Transaction owning the index
+ * @return Whether the operation is a success
+ **/
+static bool index_reserve(transaction_t *transaction) {
+  if (likely((transaction->held.size + 1) * 2
+    <= transaction->index_capacity)) {
+    return true;
+  }
+  size_t capacity = transaction->index_capacity
+    ? transaction->index_capacity * 2 : 64;
+  size_t *index = calloc(capacity, sizeof(size_t));
+  if (unlikely(!index)) {
+    return false;
+  }
+  free(transaction->index);
+  transaction->index = index;
+  transaction->index_capacity = capacity;
+  for (size_t i = 0; i < transaction->held.size; i++) {
+    index_insert(transaction, i);
+  }
+  return true;
+}
+
+/** Take a stripe in shared mode.
+ * @param lock     Stripe to take
+ * @param may_wait Whether to wait for as long as it takes
+ * @return Whether the stripe was taken
+ **/
+static bool take_shared(stripe_lock_t *lock, bool may_wait) {
+  for (size_t tries = 1;; tries++) {
+    uint64_t value = atomic_load_explicit(lock, memory_order_relaxed);
+    if (!(value & (STRIPE_WRITER | STRIPE_PENDING))) {
+      if (atomic_compare_exchange_weak_explicit(lock, &value, value + 1,
+        memory_order_acquire, memory_order_relaxed)) {
+        return true;
+      }
+      continue;
+    }
+    if (!may_wait && tries >= STRIPE_TRIES) {
+      return false;
+    }
+    stripe_wait(tries);
+  }
+}
+
+/** Take a stripe exclusively, raising the pending flag for its sharers to
+ *drain out.
+ * @param lock     Stripe to take
+ * @param mine     Number of shares held by the caller (0 or 1, upgrading)
+ * @param may_wait Whether to wait for as long as it takes
+ * @return Whether the stripe was taken (the caller's share, if any, is then
+ *gone)
+ **/
+static bool take_exclusive(stripe_lock_t *lock, uint64_t mine,
+  bool may_wait) {
+  uint64_t pending = 0;  // STRIPE_PENDING once raised by the caller
+  for (size_t tries = 1;; tries++) {
+    uint64_t value = atomic_load_explicit(lock, memory_order_relaxed);
+    if (value == (mine | pending)) {
+      if (atomic_compare_exchange_weak_explicit(lock, &value, STRIPE_WRITER,
+        memory_order_acquire, memory_order_relaxed)) {
+        return true;
+      }
+      continue;
+    }
+    if (!pending && !(value & (STRIPE_WRITER | STRIPE_PENDING))) {
+      if (atomic_compare_exchange_weak_explicit(lock, &value,
+        value | STRIPE_PENDING, memory_order_relaxed, memory_order_relaxed)) {
+        pending = STRIPE_PENDING;
+      }
+      continue;
+    }
+    if (!may_wait && tries >= STRIPE_TRIES) {
+      if (pending) {
+        atomic_fetch_and_explicit(lock, ~STRIPE_PENDING, memory_order_relaxed);
+      }
+      return false;
+    }
+    stripe_wait(tries);
+  }
+}
+
+/** Hold a stripe, if not already held in (at least) that mode.
+ * @param transaction Transaction to hold the stripe for
+ * @param lock        Stripe of the words about to be accessed
+ * @param exclusive   Whether the stripe must be held exclusively
+ * @return Whether the stripe is held (else the transaction must abort)
+ **/
+static bool hold(transaction_t *transaction, stripe_lock_t *lock,
+  bool exclusive) {
+  size_t entry = find_held(transaction, lock);
+  if (entry < transaction->held.size) {
+    held_t *held = vector_get(&(transaction->held), entry);
+    if (!exclusive || held->exclusive) {
+      return true;
+    }
+    // upgrade: the other sharers may wait for a stripe we hold, so this is
+    // only tried
+    if (!take_exclusive(lock, 1, false)) {
+      return false;
+    }
+    held->exclusive = true;
+    return true;
+  }
+  if (unlikely(!index_reserve(transaction))) {
+    return false;
+  }
+  bool may_wait = !transaction->highest || lock > transaction->highest;
+  if (!(exclusive ? take_exclusive(lock, 0, may_wait)
+    : take_shared(lock, may_wait))) {
+    return false;
+  }
+  held_t *held = vector_push(&(transaction->held));
+  if (unlikely(!held)) {
+    if (exclusive) {
+      atomic_store_explicit(lock, 0, memory_order_release);
+    } else {
+      atomic_fetch_sub_explicit(lock, 1, memory_order_release);
+    }
+    return false;
+  }
+  held->lock = lock;
+  held->exclusive = exclusive;
+  index_insert(transaction, transaction->held.size - 1);
+  if (may_wait) {
+    transaction->highest = lock;
+  }
+  return true;
+}
+
+/** [thread-safe] Read operation in the given transaction, source in the shared
+ *region and target in a private region.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param source Source start address (in the shared region)
+ * @param size   Length to copy (in bytes), must be a positive multiple of the
+ *alignment
+ * @param target Target start address (in a private region)
+ * @return Whether the whole transaction can continue
+ **/
+bool tm_read(shared_t shared, tx_t tx,
+  void const *source, size_t size, void *target) {
+  shared_region_t *region = (shared_region_t *) shared;
+  transaction_t *transaction = (transaction_t *) tx;
+  stripe_lock_t *last = NULL;  // consecutive words mostly share their stripe
+  for (size_t offset = 0; offset < size; offset += region->alignment) {
+    stripe_lock_t *lock = get_lock(region,
+      (void const *) ((uintptr_t) source + offset));
+    if (lock == last) {
+      continue;
+    }
+    if (unlikely(!hold(transaction, lock, false))) {
+      abort_transaction(region, transaction);
+      return false;
+    }
+    last = lock;
+  }
+  memcpy(target, source, size);
+  return true;
+}
+
+/** [thread-safe] Write operation in the given transaction, source in a private
+ *region and target in the shared region.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param source Source start address (in a private region)
+ * @param size   Length to copy (in bytes), must be a positive multiple of the
+ *alignment
+ * @param target Target start address (in the shared region)
+ * @return Whether the whole transaction can continue
+ **/
+bool tm_write(shared_t shared, tx_t tx,
+  void const *source, size_t size,
+  void *target) {
+  shared_region_t *region = (shared_region_t *) shared;
+  transaction_t *transaction = (transaction_t *) tx;
+  size_t alignment = region->alignment;
+  stripe_lock_t *last = NULL;
+  for (size_t offset = 0; offset < size; offset += alignment) {
+    void *word = (void *) ((uintptr_t) target + offset);
+    stripe_lock_t *lock = get_lock(region, word);
+    if (lock != last) {
+      if (unlikely(!hold(transaction, lock, true))) {
+        abort_transaction(region, transaction);
+        return false;
+      }
+      last = lock;
+    }
+    void **slot = vector_push(&(transaction->undo_words));
+    if (unlikely(!slot)) {
+      abort_transaction(region, transaction);
+      return false;
+    }
+    void *value = vector_push(&(transaction->undo_values));
+    if (unlikely(!value)) {
+      transaction->undo_words.size--;
+      abort_transaction(region, transaction);
+      return false;
+    }
+    *slot = word;
+    memcpy(value, word, alignment);
+  }
+  memcpy(target, source, size);
+  return true;
+}
+
+/** [thread-safe] Memory allocation in the given transaction.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param size   Allocation requested size (in bytes), must be a positive
+ *multiple of the alignment
+ * @param target Pointer in private memory receiving the address of the first
+ *byte of the newly allocated, aligned segment
+ * @return Whether the whole transaction can continue (success/nomem), or not
+ *(abort_alloc)
+ **/
+alloc_t tm_alloc(shared_t shared, tx_t tx, size_t size,
+  void **target) {
+  shared_region_t *region = (shared_region_t *) shared;
+  transaction_t *transaction = (transaction_t *) tx;
+  segment_node_t **slot = vector_push(&(transaction->allocated));
+  if (unlikely(!slot)) {
+    return nomem_alloc;
+  }
+  size_t header_align = region->alignment < sizeof(void *)
+    ? sizeof(void *) : region->alignment;
+  segment_node_t *node;
+  if (unlikely(posix_memalign((void **) &node, header_align,
+    region->header_size + size) != 0)) {
+    transaction->allocated.size--;
+    return nomem_alloc;
+  }
+  // nobody else can reach the segment before its address is published
+  memset(segment_words(region, node), 0, size);
+  node->prev = NULL;
+  lock_acquire(&(region->segments_lock));
+  node->next = region->segments;
+  if (node->next) {
+    node->next->prev = node;
+  }
+  region->segments = node;
+  lock_release(&(region->segments_lock));
+  *slot = node;
+  *target = segment_words(region, node);
+  return success_alloc;
+}
+
+/** [thread-safe] Memory freeing in the given transaction.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param target Address of the first byte of the previously allocated segment
+ *to deallocate
+ * @return Whether the whole transaction can continue
+ **/
+bool tm_free(shared_t shared, tx_t tx, void *target) {
+  shared_region_t *region = (shared_region_t *) shared;
+  transaction_t *transaction = (transaction_t *) tx;
+  // only released if the transaction commits
+  segment_node_t **slot = vector_push(&(transaction->freed));
+  if (unlikely(!slot)) {
+    abort_transaction(region, transaction);
+    return false;
+  }
+  *slot = segment_node(region, target);
+  return true;
+}
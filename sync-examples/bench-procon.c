@@ -0,0 +1,155 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "lock.h"
+#include "spsc.h"
+
+// Throughput of the producer-consumer handoff: the mutex and condition
+// variable scheme of procon4 against the lock-free ring of procon5, moving the
+// same records through a ring of the same capacity.
+// Usage: bench-procon [items [capacity]]
+
+#define DATA_TEXT_SIZE 1024
+#define MAX_BATCHES 8
+
+struct data {
+  char text[DATA_TEXT_SIZE];
+};
+
+static long items = 1 << 18;
+static unsigned int capacity = 8;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Records are cheap to make and to check: all their bytes derive from their round.
+static void make(struct data* data, long r) {
+  memset(data->text, (char) r, DATA_TEXT_SIZE);
+}
+
+static bool check(struct data* data, long r) {
+  return data->text[0] == (char) r && data->text[DATA_TEXT_SIZE - 1] == (char) r;
+}
+
+// Mutex + condition variable (procon4, without the prints).
+
+static struct lock_t lock;
+static struct data* buffer;
+static long produced_until;
+static long consumed_until;
+
+static void* mutex_produce(void* null) {
+  struct data local;
+  for (long r = 0; r < items; r++) {
+    make(&local, r);
+    lock_acquire(&lock);
+    while (consumed_until + capacity <= r)
+      lock_wait(&lock);
+    buffer[r % capacity] = local;
+    produced_until++;
+    lock_release(&lock);
+    lock_wake_up(&lock);
+  }
+  return NULL;
+}
+
+static void* mutex_consume(void* wrong) {
+  struct data local;
+  for (long r = 0; r < items; r++) {
+    lock_acquire(&lock);
+    while (produced_until <= r)
+      lock_wait(&lock);
+    local = buffer[r % capacity];
+    consumed_until++;
+    lock_release(&lock);
+    lock_wake_up(&lock);
+    if (!check(&local, r))
+      ++*(long*) wrong;
+  }
+  return NULL;
+}
+
+// Lock-free ring (procon5).
+
+static struct spsc_t ring;
+
+static void* spsc_produce(void* null) {
+  struct data local;
+  for (long r = 0; r < items; r++) {
+    make(&local, r);
+    *(struct data*) spsc_reserve(&ring) = local;
+    spsc_push(&ring);
+  }
+  spsc_flush(&ring);
+  return NULL;
+}
+
+static void* spsc_consume(void* wrong) {
+  struct data local;
+  for (long r = 0; r < items; r++) {
+    local = *(struct data*) spsc_peek(&ring);
+    spsc_pop(&ring);
+    if (!check(&local, r))
+      ++*(long*) wrong;
+  }
+  return NULL;
+}
+
+// Run one producer and one consumer, report the throughput and whether every record went through intact.
+static bool run(char const* name, unsigned int batch, void* (*produce)(void*), void* (*consume)(void*)) {
+  long wrong = 0;
+  pthread_t producer, consumer;
+  double start = now();
+  int res = pthread_create(&consumer, NULL, consume, &wrong);
+  assert(!res);
+  res = pthread_create(&producer, NULL, produce, NULL);
+  assert(!res);
+  res = pthread_join(producer, NULL);
+  assert(!res);
+  res = pthread_join(consumer, NULL);
+  assert(!res);
+  double elapsed = now() - start;
+  printf("%-6s | %5u | %9.1f | %9.1f | %s\n", name, batch, elapsed * 1e9 / items,
+    items * (double) DATA_TEXT_SIZE / elapsed / (1 << 20), wrong ? "WRONG" : "ok");
+  return !wrong;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1)
+    items = atol(argv[1]);
+  if (argc > 2)
+    capacity = atoi(argv[2]);
+  if (items <= 0 || capacity == 0 || (capacity & (capacity - 1)) != 0) {
+    printf("Usage: %s [items [capacity (power of 2)]]\n", argv[0]);
+    return 1;
+  }
+  printf("%ld records of %d bytes through %u slots\n", items, DATA_TEXT_SIZE, capacity);
+  printf("scheme | batch | ns/item   | MiB/s     | check\n");
+
+  bool ok = lock_init(&lock);
+  buffer = malloc(capacity * sizeof(struct data));
+  assert(ok && buffer);
+  produced_until = consumed_until = 0;
+  ok = run("mutex", 1, mutex_produce, mutex_consume);
+  free(buffer);
+  lock_cleanup(&lock);
+
+  for (unsigned int batch = 1; batch <= capacity && batch <= MAX_BATCHES; batch *= 2) {
+    bool init = spsc_init(&ring, capacity, sizeof(struct data), batch);
+    assert(init);
+    ok &= run("spsc", batch, spsc_produce, spsc_consume);
+    spsc_cleanup(&ring);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lock.h"
+
+// Cost of the counter and election primitives of counter2/4 and election2/4,
+// plus per-thread sharded counters, for 1, 2, 4... up to the given number of
+// threads. Each thread makes "runs" operations (increments or election
+// attempts), the table reports the wall-clock time, from the first thread
+// starting to the last one finishing, per operation.
+// Usage: bench-sync [runs [threads]]
+
+#define LINE_SIZE 64
+#define MAX_THREADS 256
+
+static long runs = 1 << 20;
+
+static struct lock_t lock;
+static pthread_barrier_t barrier; // threads start together
+
+// Counters.
+
+static long counter = 0;
+static atomic_long atomic_counter = 0;
+
+struct padded_shard {
+  _Alignas(LINE_SIZE) atomic_long value; // a line of its own
+};
+static struct padded_shard padded_shards[MAX_THREADS];
+static atomic_long packed_shards[MAX_THREADS]; // neighbours share lines
+
+static void* count_mutex(void* tid) {
+  for (long r = 0; r < runs; r++) {
+    lock_acquire(&lock);
+    counter++;
+    lock_release(&lock);
+  }
+  return NULL;
+}
+
+static void* count_atomic(void* tid) {
+  for (long r = 0; r < runs; r++)
+    atomic_fetch_add_explicit(&atomic_counter, 1, memory_order_relaxed);
+  return NULL;
+}
+
+// A shard has a single writer: a plain (atomic) load and store are enough, no
+// read-modify-write, concurrent readers just sum the shards.
+static void* count_padded(void* tid) {
+  atomic_long* shard = &padded_shards[(intptr_t) tid].value;
+  for (long r = 0; r < runs; r++)
+    atomic_store_explicit(shard, atomic_load_explicit(shard, memory_order_relaxed) + 1, memory_order_relaxed);
+  return NULL;
+}
+
+static void* count_packed(void* tid) {
+  atomic_long* shard = &packed_shards[(intptr_t) tid];
+  for (long r = 0; r < runs; r++)
+    atomic_store_explicit(shard, atomic_load_explicit(shard, memory_order_relaxed) + 1, memory_order_relaxed);
+  return NULL;
+}
+
+static long sum_padded(int threads) {
+  long sum = 0;
+  for (int i = 0; i < threads; i++)
+    sum += atomic_load(&padded_shards[i].value);
+  return sum;
+}
+
+static long sum_packed(int threads) {
+  long sum = 0;
+  for (int i = 0; i < threads; i++)
+    sum += atomic_load(&packed_shards[i]);
+  return sum;
+}
+
+// Elections, one per round.
+
+static long* leader;
+static atomic_long* cas_leader;
+static atomic_int* nb_leaders; // used to check correctness
+
+static void* elect_mutex(void* tid) {
+  for (long r = 0; r < runs; r++) {
+    lock_acquire(&lock);
+    if (leader[r] == 0) {
+      leader[r] = (intptr_t) tid + 1;
+      atomic_fetch_add_explicit(&nb_leaders[r], 1, memory_order_relaxed);
+    }
+    lock_release(&lock);
+  }
+  return NULL;
+}
+
+static void* elect_cas(void* tid) {
+  for (long r = 0; r < runs; r++) {
+    long expected = 0;
+    if (atomic_compare_exchange_strong(&cas_leader[r], &expected, (intptr_t) tid + 1))
+      atomic_fetch_add_explicit(&nb_leaders[r], 1, memory_order_relaxed);
+  }
+  return NULL;
+}
+
+static bool check_elections(void) {
+  for (long r = 0; r < runs; r++)
+    if (nb_leaders[r] != 1) return false;
+  return true;
+}
+
+// Benchmarks.
+
+struct primitive {
+  char const* name;
+  void* (*run)(void*);
+};
+
+static struct primitive const primitives[] = {
+  { "counter/mutex", count_mutex },
+  { "counter/fetch_add", count_atomic },
+  { "counter/sharded", count_padded },
+  { "counter/sharded-packed", count_packed },
+  { "election/mutex", elect_mutex },
+  { "election/cas", elect_cas },
+};
+#define NB_PRIMITIVES (sizeof(primitives) / sizeof(primitives[0]))
+
+static void reset(void) {
+  counter = 0;
+  atomic_store(&atomic_counter, 0);
+  for (int i = 0; i < MAX_THREADS; i++) {
+    atomic_store(&padded_shards[i].value, 0);
+    atomic_store(&packed_shards[i], 0);
+  }
+  for (long r = 0; r < runs; r++) {
+    leader[r] = 0;
+    atomic_store(&cas_leader[r], 0);
+    atomic_store(&nb_leaders[r], 0);
+  }
+}
+
+static bool check(void* (*run)(void*), int threads) {
+  long expected = runs * threads;
+  if (run == count_mutex) return counter == expected;
+  if (run == count_atomic) return atomic_load(&atomic_counter) == expected;
+  if (run == count_padded) return sum_padded(threads) == expected;
+  if (run == count_packed) return sum_packed(threads) == expected;
+  return check_elections();
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct start {
+  void* (*run)(void*);
+  intptr_t tid;
+  double begin; // each thread times itself: the threads released by the
+  double end;   // barrier may well be done before the main thread wakes up
+};
+
+static void* start(void* arg) {
+  struct start* start = arg;
+  pthread_barrier_wait(&barrier);
+  start->begin = now();
+  start->run((void*) start->tid);
+  start->end = now();
+  return NULL;
+}
+
+// Run one primitive with the given number of threads, return the time per operation (negative if incorrect).
+static double run(struct primitive const* primitive, int threads) {
+  pthread_t handlers[MAX_THREADS];
+  struct start starts[MAX_THREADS];
+  reset();
+  int res = pthread_barrier_init(&barrier, NULL, threads + 1);
+  assert(!res);
+  for (int i = 0; i < threads; i++) {
+    starts[i] = (struct start) { primitive->run, i };
+    res = pthread_create(&handlers[i], NULL, start, &starts[i]);
+    assert(!res);
+  }
+  pthread_barrier_wait(&barrier);
+  double begin = 0, end = 0;
+  for (int i = 0; i < threads; i++) {
+    res = pthread_join(handlers[i], NULL);
+    assert(!res);
+    if (i == 0 || starts[i].begin < begin) begin = starts[i].begin;
+    if (i == 0 || starts[i].end > end) end = starts[i].end;
+  }
+  double elapsed = end - begin;
+  pthread_barrier_destroy(&barrier);
+  if (!check(primitive->run, threads))
+    return -1;
+  return elapsed * 1e9 / ((double) runs * threads);
+}
+
+int main(int argc, char** argv) {
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  int max_threads = online < 1 ? 1 : online > MAX_THREADS ? MAX_THREADS : online; // only an explicit count is rejected
+  if (argc > 1)
+    runs = atol(argv[1]);
+  if (argc > 2)
+    max_threads = atoi(argv[2]);
+  if (runs <= 0 || max_threads <= 0 || max_threads > MAX_THREADS) {
+    printf("Usage: %s [runs [threads (at most %d)]]\n", argv[0], MAX_THREADS);
+    return 1;
+  }
+  bool ok = lock_init(&lock);
+  leader = malloc(runs * sizeof(*leader));
+  cas_leader = malloc(runs * sizeof(*cas_leader));
+  nb_leaders = malloc(runs * sizeof(*nb_leaders));
+  assert(ok && leader && cas_leader && nb_leaders);
+
+  int counts[32];
+  int nb_counts = 0;
+  for (int threads = 1; threads < max_threads; threads *= 2)
+    counts[nb_counts++] = threads;
+  counts[nb_counts++] = max_threads;
+
+  printf("%ld operations per thread, ns per operation\n", runs);
+  printf("%-22s", "primitive \\ threads");
+  for (int i = 0; i < nb_counts; i++)
+    printf(" | %7d", counts[i]);
+  printf("\n");
+  for (size_t p = 0; p < NB_PRIMITIVES; p++) {
+    printf("%-22s", primitives[p].name);
+    for (int i = 0; i < nb_counts; i++) {
+      double ns = run(&primitives[p], counts[i]);
+      if (ns < 0) {
+        printf(" |   WRONG");
+        ok = false;
+      } else {
+        printf(" | %7.2f", ns);
+      }
+      fflush(stdout);
+    }
+    printf("\n");
+  }
+
+  free(nb_leaders);
+  free(cas_leader);
+  free(leader);
+  lock_cleanup(&lock);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+#include <pthread.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "spsc.h"
+
+#define RUNS 4096
+#define DATA_TEXT_SIZE 1024
+#define BUFFER_SIZE 8
+#define BATCH 4
+
+struct data {
+  char text[DATA_TEXT_SIZE];
+};
+
+static struct spsc_t ring; // a single producer, a single consumer
+
+bool are_same(struct data* a, struct data* b) {
+  for (int i = 0; i < DATA_TEXT_SIZE; i++)
+    if (a->text[i] != b->text[i]) return false;
+  return true;
+}
+
+struct data produced[RUNS] = { 0 }; // used to check correctness
+struct data consumed[RUNS] = { 0 }; // used to check correctness
+
+void* produce(void* null) {
+  for (int r = 0; r < RUNS; r++) {
+    for (int i = 0; i < DATA_TEXT_SIZE; i++)
+      produced[r].text[i] = rand();
+    // The ring hands out a free slot (waiting for the consumer to free one if
+    // need be), we fill it in place then push it. Pushed items are published
+    // by batches of BATCH: a single store on the shared head index, instead of
+    // a lock round-trip and a broadcast for every item.
+    struct data* slot = spsc_reserve(&ring);
+    *slot = produced[r];
+    spsc_push(&ring);
+  }
+  spsc_flush(&ring); // The last batch may be incomplete, publish it anyway.
+}
+
+void* consume(void* null) {
+  for (int r = 0; r < RUNS; r++) {
+    // The ring hands out the next item, spinning for a while then sleeping on
+    // a futex if there is none yet. The producer only calls into the kernel to
+    // wake us up if we actually went to sleep.
+    struct data* slot = spsc_peek(&ring);
+    consumed[r] = *slot;
+    spsc_pop(&ring); // The slot can be reused by the producer.
+  }
+}
+
+int main() {
+  bool ok = spsc_init(&ring, BUFFER_SIZE, sizeof(struct data), BATCH);
+  assert(ok);
+  int res;
+  pthread_t producer;
+  res = pthread_create(&producer, NULL, produce, NULL);
+  assert(!res);
+
+  pthread_t consumer;
+  res = pthread_create(&consumer, NULL, consume, NULL);
+  assert(!res);
+
+  res = pthread_join(consumer, NULL);
+  assert(!res);
+
+  res = pthread_join(producer, NULL);
+  assert(!res);
+
+  spsc_cleanup(&ring);
+
+  int r = 0;
+  for (; r < RUNS; r++) {
+    if (!are_same(&produced[r], &consumed[r])) {
+      printf("Consumed the wrong data on round %d.\n", r);
+      break;
+    }
+  }
+  if (r == RUNS) {
+    printf("Looks correct to me! :)\n");
+  }
+}
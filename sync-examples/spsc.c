@@ -0,0 +1,130 @@
+#define _GNU_SOURCE
+#include <linux/futex.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "spsc.h"
+
+_Static_assert(sizeof(atomic_uint) == sizeof(uint32_t), "futexes are 32-bit words");
+
+static void futex_wait(atomic_uint* word, unsigned int seen) {
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+}
+
+static void futex_wake(atomic_uint* word) {
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+static void cpu_relax(void) {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/** Publish an index, waking the other side up if it (may) sleep on it.
+ * @param word   Index to publish
+ * @param value  New value of the index
+ * @param parked Whether the other side (may) sleep on the index
+**/
+static void publish(atomic_uint* word, unsigned int value, atomic_uint* parked) {
+    // The store and the load are sequentially consistent: either the parking
+    // side sees the new value, or we see its flag (see 'wait_change').
+    atomic_store(word, value);
+    if (atomic_load(parked))
+        futex_wake(word);
+}
+
+/** Wait for an index to change: spin a bit, then park on it.
+ * @param word   Index to wait on
+ * @param seen   Last value read from the index
+ * @param parked Our flag telling the other side we (may) sleep on the index
+ * @param spins  Number of polls before parking
+ * @return New value of the index
+**/
+static unsigned int wait_change(atomic_uint* word, unsigned int seen, atomic_uint* parked, int spins) {
+    for (int i = 0; i < spins; i++) {
+        unsigned int value = atomic_load_explicit(word, memory_order_acquire);
+        if (value != seen)
+            return value;
+        cpu_relax();
+    }
+    while (true) {
+        atomic_store(parked, 1);
+        unsigned int value = atomic_load(word);
+        if (value != seen) {
+            atomic_store_explicit(parked, 0, memory_order_relaxed);
+            return value;
+        }
+        futex_wait(word, seen); // returns at once if the index changed meanwhile
+    }
+}
+
+bool spsc_init(struct spsc_t* ring, unsigned int capacity, size_t item_size, unsigned int batch) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 || batch == 0 || batch > capacity)
+        return false;
+    ring->slots = malloc(capacity * item_size);
+    if (!ring->slots)
+        return false;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->producer_parked, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->consumer_parked, 0);
+    ring->produced = 0;
+    ring->producer_tail = 0;
+    ring->consumed = 0;
+    ring->consumer_head = 0;
+    ring->item_size = item_size;
+    ring->capacity = capacity;
+    ring->batch = batch;
+    // spinning only helps when the other side runs meanwhile on another CPU
+    ring->spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPSC_SPINS : 0;
+    return true;
+}
+
+void spsc_cleanup(struct spsc_t* ring) {
+    free(ring->slots);
+}
+
+void* spsc_reserve(struct spsc_t* ring) {
+    // indices are free-running, their differences stay right when they wrap
+    if (ring->produced - ring->producer_tail == ring->capacity) { // looks full
+        ring->producer_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (ring->produced - ring->producer_tail == ring->capacity) { // is full
+            spsc_flush(ring); // the consumer may be waiting for our pending items
+            ring->producer_tail = wait_change(&ring->tail, ring->producer_tail, &ring->producer_parked, ring->spins);
+        }
+    }
+    return ring->slots + (ring->produced & (ring->capacity - 1)) * ring->item_size;
+}
+
+void spsc_push(struct spsc_t* ring) {
+    ring->produced++;
+    if (ring->produced - atomic_load_explicit(&ring->head, memory_order_relaxed) >= ring->batch)
+        spsc_flush(ring);
+}
+
+void spsc_flush(struct spsc_t* ring) {
+    if (atomic_load_explicit(&ring->head, memory_order_relaxed) != ring->produced)
+        publish(&ring->head, ring->produced, &ring->consumer_parked);
+}
+
+void* spsc_peek(struct spsc_t* ring) {
+    if (ring->consumer_head == ring->consumed) { // looks empty
+        ring->consumer_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (ring->consumer_head == ring->consumed) { // is empty
+            // the producer may be waiting for our pending releases
+            if (atomic_load_explicit(&ring->tail, memory_order_relaxed) != ring->consumed)
+                publish(&ring->tail, ring->consumed, &ring->producer_parked);
+            ring->consumer_head = wait_change(&ring->head, ring->consumer_head, &ring->consumer_parked, ring->spins);
+        }
+    }
+    return ring->slots + (ring->consumed & (ring->capacity - 1)) * ring->item_size;
+}
+
+void spsc_pop(struct spsc_t* ring) {
+    ring->consumed++;
+    if (ring->consumed - atomic_load_explicit(&ring->tail, memory_order_relaxed) >= ring->batch)
+        publish(&ring->tail, ring->consumed, &ring->producer_parked);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SPSC_LINE_SIZE 64 // size of a cache line, the indices written by each side live on lines of their own
+#define SPSC_SPINS 1024   // number of polls before parking, while waiting for the other side (none on a single CPU)
+
+/**
+ * @brief A lock-free ring moving fixed-size items from a single producer to a
+ * single consumer. Each side publishes its index once every "batch" items (or
+ * when it is about to wait), so the other side's cached copy of that index
+ * goes stale (and its line moves) once per batch rather than once per item.
+ * A side finding the ring full (resp. empty) spins a bit, then parks on a
+ * futex, and the other side only calls into the kernel when it knows it
+ * parked.
+ */
+struct spsc_t {
+    // written by the producer, read by the consumer
+    _Alignas(SPSC_LINE_SIZE) atomic_uint head;  // items published
+    atomic_uint producer_parked;                // whether the producer (may) sleep on 'tail'
+    // written by the consumer, read by the producer
+    _Alignas(SPSC_LINE_SIZE) atomic_uint tail;  // items released
+    atomic_uint consumer_parked;                // whether the consumer (may) sleep on 'head'
+    // private to the producer
+    _Alignas(SPSC_LINE_SIZE) unsigned int produced;  // items produced (published or not)
+    unsigned int producer_tail;                      // last value read from 'tail'
+    // private to the consumer
+    _Alignas(SPSC_LINE_SIZE) unsigned int consumed;  // items consumed (released or not)
+    unsigned int consumer_head;                      // last value read from 'head'
+    // read-only
+    _Alignas(SPSC_LINE_SIZE) char* slots;  // first slot of the ring
+    size_t item_size;                      // size of a slot
+    unsigned int capacity;                 // number of slots, a power of 2
+    unsigned int batch;                    // number of items each side moves before publishing its index
+    int spins;                             // number of polls before parking
+};
+
+/** Initialize the given ring.
+ * @param ring      Ring to initialize
+ * @param capacity  Number of slots, a power of 2
+ * @param item_size Size of each slot (in bytes)
+ * @param batch     Number of items each side moves before publishing its index, in [1, capacity]
+ * @return Whether the operation is a success
+**/
+bool spsc_init(struct spsc_t* ring, unsigned int capacity, size_t item_size, unsigned int batch);
+
+/** Clean up the given ring.
+ * @param ring Ring to clean up
+**/
+void spsc_cleanup(struct spsc_t* ring);
+
+/** [producer] Wait for a free slot.
+ * @param ring Ring to produce into
+ * @return Slot to fill, then to hand over with spsc_push
+**/
+void* spsc_reserve(struct spsc_t* ring);
+
+/** [producer] Hand the slot returned by spsc_reserve over to the consumer; it
+ * is published with the rest of its batch.
+ * @param ring Ring to produce into
+**/
+void spsc_push(struct spsc_t* ring);
+
+/** [producer] Publish the items pushed so far right away (e.g. after the last
+ * item, the consumer could otherwise wait for the rest of its batch forever).
+ * @param ring Ring to produce into
+**/
+void spsc_flush(struct spsc_t* ring);
+
+/** [consumer] Wait for an item.
+ * @param ring Ring to consume from
+ * @return Slot holding the item, to give back with spsc_pop once read
+**/
+void* spsc_peek(struct spsc_t* ring);
+
+/** [consumer] Give the slot returned by spsc_peek back to the producer; it is
+ * released with the rest of its batch.
+ * @param ring Ring to consume from
+**/
+void spsc_pop(struct spsc_t* ring);
@@ -0,0 +1,803 @@
+/**
+ * @file   tm.c
+ * @author [...]
+ *
+ * @section LICENSE
+ *
+ * [...]
+ *
+ * @section DESCRIPTION
+ *
+ * TL2-style transaction manager: a global version clock, versioned
+ * write-locks on word stripes, invisible (validated) reads, and a redo log
+ * written back under commit-time locking.
+ **/
+
+// Requested features
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#ifdef __STDC_NO_ATOMICS__
+#error Current C11 compiler does not support atomic operations
+#endif
+
+// External headers
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Internal headers
+#include <tm.h>
+
+#include "lock.h"
+#include "macros.h"
+
+// Each word of the shared memory is mapped (by address) onto one of a fixed
+// number of stripes, each protected by a versioned write-lock:
+// - unlocked: the version (clock value) of the last commit that wrote it << 1
+// - locked:   the address of the owning transaction's descriptor | 1
+typedef _Atomic(uint64_t) stripe_lock_t;
+#define STRIPE_COUNT ((size_t) 1 << 20)
+static const uint64_t STRIPE_LOCKED = 1;
+
+static inline bool stripe_is_locked(uint64_t value) {
+  return value & STRIPE_LOCKED;
+}
+static inline uint64_t stripe_version(uint64_t value) {
+  return value >> 1;
+}
+
+typedef struct vector_t {  // growable array of fixed-size items
+    char *items;
+    size_t size;
+    size_t capacity;
+    size_t item_size;
+} vector_t;
+
+static void vector_init(vector_t *vector, size_t item_size) {
+  vector->items = NULL;
+  vector->size = 0;
+  vector->capacity = 0;
+  vector->item_size = item_size;
+}
+
+/** Append an (uninitialized) item to the vector.
+ * @param vector Vector to grow
+ * @return Address of the new item, NULL on allocation failure
+ **/
+static void *vector_push(vector_t *vector) {
+  if (unlikely(vector->size == vector->capacity)) {
+    size_t capacity = vector->capacity ? vector->capacity * 2 : 16;
+    char *items = realloc(vector->items, capacity * vector->item_size);
+    if (unlikely(!items)) {
+      return NULL;
+    }
+    vector->items = items;
+    vector->capacity = capacity;
+  }
+  return vector->items + vector->size++ * vector->item_size;
+}
+
+static inline void *vector_get(vector_t const *vector, size_t index) {
+  return vector->items + index * vector->item_size;
+}
+
+typedef struct write_entry_t {
+    void *target;         // shared word written
+    stripe_lock_t *lock;  // its stripe
+    uint64_t locked_from; // stripe value before this transaction locked it
+    size_t index_slot;    // slot of the entry in the write set's index
+    bool owns_lock;       // whether this entry locked the stripe at commit
+} write_entry_t;
+
+/**
+ * @brief Allocated segments are linked together (by a header placed before
+ * their first word) so that the region can release the remaining ones.
+ */
+typedef struct segment_node_t {
+    struct segment_node_t *prev;
+    struct segment_node_t *next;
+} segment_node_t;
+
+/**
+ * @brief Per-thread transaction descriptor, reused by every transaction the
+ * thread runs on the region; it also holds the thread's epoch announcement
+ * and the segments it retired, for safe reclamation.
+ */
+typedef struct transaction_t {
+    bool is_ro;
+    uint64_t read_version;  // clock value the transaction's snapshot is at
+    vector_t read_set;      // stripe_lock_t*, stripes to validate at commit
+    vector_t write_set;     // write_entry_t, in program order
+    vector_t write_values;  // one word per write entry
+    // open-addressing index (by word address) of the write set: entry index
+    // + 1, 0 for an empty slot
+    size_t *index;
+    size_t index_capacity;
+    vector_t allocated;     // segment_node_t*, released if aborting
+    vector_t freed;         // segment_node_t*, retired if committing
+    // epoch-based reclamation: a committed tm_free only unlinks its segment,
+    // which optimistic readers may still be accessing. Segments retired in
+    // epoch e are released once the region's epoch reached e + 2.
+    _Atomic(uint64_t) announced;  // epoch << 1 | whether in a transaction
+    vector_t retired[3];          // segment_node_t*, by epoch modulo 3
+    uint64_t retired_epoch[3];
+    void const *owner;            // thread of the descriptor (its cache's address)
+    struct transaction_t *next;   // descriptors of the region
+} transaction_t;
+
+typedef struct shared_region_t {
+    _Atomic(uint64_t) clock;  // global version clock
+    stripe_lock_t *locks;     // STRIPE_COUNT stripes
+    _Atomic(uint64_t) epoch;  // reclamation epoch
+    _Atomic(transaction_t *) descriptors;
+    struct lock_t segments_lock;  // protects the list of segments
+    segment_node_t *segments;
+    uint64_t uid;
+    void *start;
+    size_t size;
+    size_t alignment;
+    size_t header_size;  // segment header, keeping the words aligned
+    int alignment_shift;
+} shared_region_t;
+
+static _Atomic(uint64_t) regions_counter = 1;
+
+// each thread caches its descriptor of the region it last used; a region is
+// identified by a unique id, as its address may be reused once destroyed
+static _Thread_local struct {
+    uint64_t region_uid;
+    transaction_t *descriptor;
+} descriptor_cache;
+
+static inline stripe_lock_t *get_lock(shared_region_t const *region,
+  void const *word) {
+  uintptr_t index = (uintptr_t) word >> region->alignment_shift;
+  // spread consecutive words of unrelated segments over the whole table
+  index ^= index >> 20;
+  return &(region->locks[index & (STRIPE_COUNT - 1)]);
+}
+
+static inline uint64_t locked_by(transaction_t const *transaction) {
+  return (uint64_t) (uintptr_t) transaction | STRIPE_LOCKED;
+}
+
+static inline void *segment_words(shared_region_t const *region,
+  segment_node_t *node) {
+  return (void *) ((uintptr_t) node + region->header_size);
+}
+
+static inline segment_node_t *segment_node(shared_region_t const *region,
+  void *words) {
+  return (segment_node_t *) ((uintptr_t) words - region->header_size);
+}
+
+/** Release a segment that no transaction can access anymore.
+ * @param region Shared memory region
+ * @param node   Segment to release
+ **/
+static void segment_release(shared_region_t *region, segment_node_t *node) {
+  lock_acquire(&(region->segments_lock));
+  if (node->prev) {
+    node->prev->next = node->next;
+  } else {
+    region->segments = node->next;
+  }
+  if (node->next) {
+    node->next->prev = node->prev;
+  }
+  lock_release(&(region->segments_lock));
+  free(node);
+}
+
+static void release_bucket(shared_region_t *region, vector_t *bucket) {
+  for (size_t i = 0; i < bucket->size; i++) {
+    segment_release(region, *(segment_node_t **) vector_get(bucket, i));
+  }
+  bucket->size = 0;
+}
+
+/** Advance the reclamation epoch if every thread in a transaction announced
+ *the current one.
+ * @param region Shared memory region
+ **/
+static void try_advance_epoch(shared_region_t *region) {
+  uint64_t epoch = atomic_load(&(region->epoch));
+  for (transaction_t *descriptor = atomic_load(&(region->descriptors));
+    descriptor; descriptor = descriptor->next) {
+    uint64_t announced = atomic_load(&(descriptor->announced));
+    if ((announced & 1) && (announced >> 1) != epoch) {
+      return;
+    }
+  }
+  atomic_compare_exchange_strong(&(region->epoch), &epoch, epoch + 1);
+}
+
+/** Retire a segment unlinked by a committed transaction.
+ * @param region      Shared memory region
+ * @param transaction Committed transaction
+ * @param node        Segment to retire
+ * @return Whether the segment could be retired (else it's leaked to the region)
+ **/
+static bool retire_segment(shared_region_t *region,
+  transaction_t *transaction, segment_node_t *node) {
+  // the unlinking write-back must be visible to whoever observes the epoch
+  atomic_thread_fence(memory_order_seq_cst);
+  uint64_t epoch = atomic_load(&(region->epoch));
+  size_t bucket = epoch % 3;
+  if (transaction->retired_epoch[bucket] != epoch) {
+    // holds segments retired in epoch - 3 or before
+    release_bucket(region, &(transaction->retired[bucket]));
+    transaction->retired_epoch[bucket] = epoch;
+  }
+  segment_node_t **slot = vector_push(&(transaction->retired[bucket]));
+  if (unlikely(!slot)) {
+    return false;
+  }
+  *slot = node;
+  return true;
+}
+
+/** Release the retired segments that became safe to release.
+ * @param region      Shared memory region
+ * @param transaction Descriptor of the calling thread
+ * @param epoch       Current epoch
+ **/
+static void reclaim_segments(shared_region_t *region,
+  transaction_t *transaction, uint64_t epoch) {
+  for (size_t bucket = 0; bucket < 3; bucket++) {
+    if (transaction->retired[bucket].size > 0
+      && transaction->retired_epoch[bucket] + 2 <= epoch) {
+      release_bucket(region, &(transaction->retired[bucket]));
+    }
+  }
+}
+
+/** Create (i.e. allocate + init) a new shared memory region, with one first
+ *non-free-able allocated segment of the requested size and alignment.
+ * @param size  Size of the first shared segment of memory to allocate (in
+ *bytes), must be a positive multiple of the alignment
+ * @param align Alignment (in bytes, must be a power of 2) that the shared
+ *memory region must support
+ * @return Opaque shared memory region handle, 'invalid_shared' on failure
+ **/
+shared_t tm_create(size_t size, size_t align) {
+  shared_region_t *region = malloc(sizeof(shared_region_t));
+  if (unlikely(!region)) {
+    return invalid_shared;
+  }
+  region->locks = calloc(STRIPE_COUNT, sizeof(stripe_lock_t));
+  if (unlikely(!region->locks)) {
+    free(region);
+    return invalid_shared;
+  }
+  if (unlikely(!lock_init(&(region->segments_lock)))) {
+    free(region->locks);
+    free(region);
+    return invalid_shared;
+  }
+  size_t header_align = align < sizeof(void *) ? sizeof(void *) : align;
+  region->header_size = (sizeof(segment_node_t) + header_align - 1)
+    / header_align * header_align;
+  segment_node_t *node;
+  if (unlikely(posix_memalign((void **) &node, header_align,
+    region->header_size + size) != 0)) {
+    lock_cleanup(&(region->segments_lock));
+    free(region->locks);
+    free(region);
+    return invalid_shared;
+  }
+  node->prev = NULL;
+  node->next = NULL;
+  region->segments = node;
+  region->start = segment_words(region, node);
+  memset(region->start, 0, size);
+  atomic_init(&(region->clock), 0);
+  atomic_init(&(region->epoch), 0);
+  atomic_init(&(region->descriptors), NULL);
+  region->uid = atomic_fetch_add(&regions_counter, 1);
+  region->size = size;
+  region->alignment = align;
+  region->alignment_shift = __builtin_ctzl(align);
+  return region;
+}
+
+/** Destroy (i.e. clean-up + free) a given shared memory region.
+ * @param shared Shared memory region to destroy, with no running transaction
+ **/
+void tm_destroy(shared_t shared) {
+  shared_region_t *region = (shared_region_t *) shared;
+  transaction_t *descriptor = atomic_load(&(region->descriptors));
+  while (descriptor) {
+    transaction_t *next = descriptor->next;
+    free(descriptor->read_set.items);
+    free(descriptor->write_set.items);
+    free(descriptor->write_values.items);
+    free(descriptor->index);
+    free(descriptor->allocated.items);
+    free(descriptor->freed.items);
+    for (size_t bucket = 0; bucket < 3; bucket++) {
+      // the retired segments are still in the region's list
+      free(descriptor->retired[bucket].items);
+    }
+    free(descriptor);
+    descriptor = next;
+  }
+  while (region->segments) {
+    segment_node_t *next = region->segments->next;
+    free(region->segments);
+    region->segments = next;
+  }
+  lock_cleanup(&(region->segments_lock));
+  free(region->locks);
+  free(region);
+}
+
+/** [thread-safe] Return the start address of the first allocated segment in
+ *the shared memory region.
+ * @param shared Shared memory region to query
+ * @return Start address of the first allocated segment
+ **/
+void *tm_start(shared_t shared) {
+  return ((shared_region_t *) shared)->start;
+}
+
+/** [thread-safe] Return the size (in bytes) of the first allocated segment of
+ *the shared memory region.
+ * @param shared Shared memory region to query
+ * @return First allocated segment size
+ **/
+size_t tm_size(shared_t shared) {
+  return ((shared_region_t *) shared)->size;
+}
+
+/** [thread-safe] Return the alignment (in bytes) of the memory accesses on
+ *the given shared memory region.
+ * @param shared Shared memory region to query
+ * @return Alignment used globally
+ **/
+size_t tm_align(shared_t shared) {
+  return ((shared_region_t *) shared)->alignment;
+}
+
+/** Get the calling thread's descriptor of the region, registering one on the
+ *thread's first transaction.
+ * @param region Shared memory region
+ * @return Descriptor, NULL on allocation failure
+ **/
+static transaction_t *get_descriptor(shared_region_t *region) {
+  if (likely(descriptor_cache.region_uid == region->uid)) {
+    return descriptor_cache.descriptor;
+  }
+  void const *owner = &descriptor_cache;
+  transaction_t *descriptor;
+  // a thread switching regions already has one (only it can register it)
+  for (descriptor = atomic_load(&(region->descriptors)); descriptor;
+    descriptor = descriptor->next) {
+    if (descriptor->owner == owner) {
+      descriptor_cache.region_uid = region->uid;
+      descriptor_cache.descriptor = descriptor;
+      return descriptor;
+    }
+  }
+  descriptor = malloc(sizeof(transaction_t));
+  if (unlikely(!descriptor)) {
+    return NULL;
+  }
+  descriptor->owner = owner;
+  vector_init(&(descriptor->read_set), sizeof(stripe_lock_t *));
+  vector_init(&(descriptor->write_set), sizeof(write_entry_t));
+  vector_init(&(descriptor->write_values), region->alignment);
+  descriptor->index = NULL;
+  descriptor->index_capacity = 0;
+  vector_init(&(descriptor->allocated), sizeof(segment_node_t *));
+  vector_init(&(descriptor->freed), sizeof(segment_node_t *));
+  atomic_init(&(descriptor->announced), 0);
+  for (size_t bucket = 0; bucket < 3; bucket++) {
+    vector_init(&(descriptor->retired[bucket]), sizeof(segment_node_t *));
+    descriptor->retired_epoch[bucket] = 0;
+  }
+  descriptor->next = atomic_load(&(region->descriptors));
+  while (!atomic_compare_exchange_weak(&(region->descriptors),
+    &(descriptor->next), descriptor)) {}
+  descriptor_cache.region_uid = region->uid;
+  descriptor_cache.descriptor = descriptor;
+  return descriptor;
+}
+
+/** [thread-safe] Begin a new transaction on the given shared memory region.
+ * @param shared Shared memory region to start a transaction on
+ * @param is_ro  Whether the transaction is read-only
+ * @return Opaque transaction ID, 'invalid_tx' on failure
+ **/
+tx_t tm_begin(shared_t shared, bool is_ro) {
+  shared_region_t *region = (shared_region_t *) shared;
+  transaction_t *transaction = get_descriptor(region);
+  if (unlikely(!transaction)) {
+    return invalid_tx;
+  }
+  transaction->is_ro = is_ro;
+  // announce the epoch before reading any shared word (nor segment address)
+  uint64_t epoch = atomic_load(&(region->epoch));
+  atomic_store(&(transaction->announced), epoch << 1 | 1);
+  atomic_thread_fence(memory_order_seq_cst);
+  reclaim_segments(region, transaction, epoch);
+  transaction->read_version = atomic_load_explicit(&(region->clock),
+    memory_order_acquire);
+  return (tx_t) transaction;
+}
+
+/** Clear the transaction's logs and leave its epoch.
+ * @param region      Shared memory region
+ * @param transaction Ending transaction
+ **/
+static void finish(shared_region_t *region, transaction_t *transaction) {
+  for (size_t i = 0; i < transaction->write_set.size; i++) {
+    write_entry_t *entry = vector_get(&(transaction->write_set), i);
+    transaction->index[entry->index_slot] = 0;
+  }
+  transaction->read_set.size = 0;
+  transaction->write_set.size = 0;
+  transaction->write_values.size = 0;
+  transaction->allocated.size = 0;
+  transaction->freed.size = 0;
+  uint64_t announced = atomic_load_explicit(&(transaction->announced),
+    memory_order_relaxed);
+  atomic_store_explicit(&(transaction->announced), announced & ~(uint64_t) 1,
+    memory_order_release);
+  if (transaction->retired[0].size + transaction->retired[1].size
+    + transaction->retired[2].size > 0) {
+    try_advance_epoch(region);
+  }
+}
+
+/** Abort the transaction: unlock the stripes it locked, release the segments
+ *it allocated (their addresses were never published) and leave its epoch.
+ * @param region      Shared memory region
+ * @param transaction Aborting transaction
+ **/
+static void abort_transaction(shared_region_t *region,
+  transaction_t *transaction) {
+  for (size_t i = 0; i < transaction->write_set.size; i++) {
+    write_entry_t *entry = vector_get(&(transaction->write_set), i);
+    if (entry->owns_lock) {
+      atomic_store_explicit(entry->lock, entry->locked_from,
+        memory_order_release);
+    }
+  }
+  for (size_t i = 0; i < transaction->allocated.size; i++) {
+    segment_release(region,
+      *(segment_node_t **) vector_get(&(transaction->allocated), i));
+  }
+  finish(region, transaction);
+}
+
+/** Lock the stripes of every written word, at commit time.
+ * @param transaction Committing transaction
+ * @return Whether every stripe could be locked
+ **/
+static bool lock_write_set(transaction_t *transaction) {
+  uint64_t mine = locked_by(transaction);
+  for (size_t i = 0; i < transaction->write_set.size; i++) {
+    write_entry_t *entry = vector_get(&(transaction->write_set), i);
+    uint64_t value = atomic_load_explicit(entry->lock, memory_order_relaxed);
+    if (value == mine) { // stripe shared with a word written before
+      continue;
+    }
+    // a stripe written since the snapshot may back a word read before, and
+    // whether it does isn't tracked: conservatively abort
+    if (stripe_is_locked(value)
+      || stripe_version(value) > transaction->read_version
+      || !atomic_compare_exchange_strong_explicit(entry->lock, &value, mine,
+        memory_order_acquire, memory_order_relaxed)) {
+      return false;
+    }
+    entry->locked_from = value;
+    entry->owns_lock = true;
+  }
+  return true;
+}
+
+/** Check that no stripe in the read set changed since the snapshot.
+ * @param transaction Committing transaction, holding its write locks
+ * @return Whether the reads are still consistent
+ **/
+static bool validate_read_set(transaction_t *transaction) {
+  uint64_t mine = locked_by(transaction);
+  for (size_t i = 0; i < transaction->read_set.size; i++) {
+    stripe_lock_t *lock = *(stripe_lock_t **) vector_get(
+      &(transaction->read_set), i);
+    uint64_t value = atomic_load_explicit(lock, memory_order_acquire);
+    if (value == mine) { // checked when locked
+      continue;
+    }
+    if (stripe_is_locked(value)
+      || stripe_version(value) > transaction->read_version) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** [thread-safe] End the given transaction.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to end
+ * @return Whether the whole transaction committed
+ **/
+bool tm_end(shared_t shared, tx_t tx) {
+  shared_region_t *region = (shared_region_t *) shared;
+  transaction_t *transaction = (transaction_t *) tx;
+  if (transaction->is_ro || (transaction->write_set.size == 0
+    && transaction->freed.size == 0)) {
+    // every read was consistent with the snapshot when it happened
+    finish(region, transaction);
+    return true;
+  }
+  for (size_t i = 0; i < transaction->write_set.size; i++) {
+    ((write_entry_t *) vector_get(&(transaction->write_set), i))->owns_lock
+      = false;
+  }
+  if (!lock_write_set(transaction)) {
+    abort_transaction(region, transaction);
+    return false;
+  }
+  uint64_t write_version = atomic_fetch_add(&(region->clock), 1) + 1;
+  // no other commit in between: the snapshot is still the latest one
+  if (write_version != transaction->read_version + 1
+    && !validate_read_set(transaction)) {
+    abort_transaction(region, transaction);
+    return false;
+  }
+  size_t alignment = region->alignment;
+  for (size_t i = 0; i < transaction->write_set.size; i++) {
+    write_entry_t *entry = vector_get(&(transaction->write_set), i);
+    memcpy(entry->target, vector_get(&(transaction->write_values), i),
+      alignment);
+  }
+  for (size_t i = 0; i < transaction->write_set.size; i++) {
+    write_entry_t *entry = vector_get(&(transaction->write_set), i);
+    if (entry->owns_lock) {
+      atomic_store_explicit(entry->lock, write_version << 1,
+        memory_order_release);
+    }
+  }
+  for (size_t i = 0; i < transaction->freed.size; i++) {
+    segment_node_t *node = *(segment_node_t **) vector_get(
+      &(transaction->freed), i);
+    if (unlikely(!retire_segment(region, transaction, node))) {
+      break; // the remaining segments are released with the region
+    }
+  }
+  finish(region, transaction);
+  return true;
+}
+
+static inline size_t index_hash(shared_region_t const *region,
+  void const *word, size_t capacity) {
+  uint64_t hash = ((uintptr_t) word >> region->alignment_shift)
+    * UINT64_C(0x9e3779b97f4a7c15);
+  return (size_t) (hash >> 32) & (capacity - 1);
+}
+
+/** Find the write entry of a word.
+ * @param region      Shared memory region
+ * @param transaction Transaction to search the write set of
+ * @param word        Shared word
+ * @return Index of the entry, the write set's size if none
+ **/
+static size_t find_write(shared_region_t const *region,
+  transaction_t const *transaction, void const *word) {
+  if (transaction->write_set.size == 0) {
+    return 0;
+  }
+  size_t mask = transaction->index_capacity - 1;
+  for (size_t slot = index_hash(region, word, transaction->index_capacity);;
+    slot = (slot + 1) & mask) {
+    size_t entry = transaction->index[slot];
+    if (entry == 0) {
+      return transaction->write_set.size;
+    }
+    if (((write_entry_t *) vector_get(&(transaction->write_set),
+      entry - 1))->target == word) {
+      return entry - 1;
+    }
+  }
+}
+
+/** Place an entry in the write set's index, slot by linear probing.
+ * @param region      Shared memory region
+ * @param transaction Transaction owning the index
+ * @param entry       Index of the entry, not in the index yet
+ **/
+static void index_insert(shared_region_t const *region,
+  transaction_t *transaction, size_t entry) {
+  write_entry_t *write = vector_get(&(transaction->write_set), entry);
+  size_t mask = transaction->index_capacity - 1;
+  size_t slot = index_hash(region, write->target,
+    transaction->index_capacity);
+  while (transaction->index[slot] != 0) {
+    slot = (slot + 1) & mask;
+  }
+  transaction->index[slot] = entry + 1;
+  write->index_slot = slot;
+}
+
+/** Make room in the write set's index for one more entry (at most half full).
+ * @param region      Shared memory region
+ * @param transaction Transaction owning the index
+ * @return Whether the operation is a success
+ **/
+static bool index_reserve(shared_region_t const *region,
+  transaction_t *transaction) {
+  if (likely((transaction->write_set.size + 1) * 2
+    <= transaction->index_capacity)) {
+    return true;
+  }
+  size_t capacity = transaction->index_capacity
+    ? transaction->index_capacity * 2 : 64;
+  size_t *index = calloc(capacity, sizeof(size_t));
+  if (unlikely(!index)) {
+    return false;
+  }
+  free(transaction->index);
+  transaction->index = index;
+  transaction->index_capacity = capacity;
+  for (size_t i = 0; i < transaction->write_set.size; i++) {
+    index_insert(region, transaction, i);
+  }
+  return true;
+}
+
+/** [thread-safe] Read operation in the given transaction, source in the shared
+ *region and target in a private region.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param source Source start address (in the shared region)
+ * @param size   Length to copy (in bytes), must be a positive multiple of the
+ *alignment
+ * @param target Target start address (in a private region)
+ * @return Whether the whole transaction can continue
+ **/
+bool tm_read(shared_t shared, tx_t tx,
+  void const *source, size_t size, void *target) {
+  shared_region_t *region = (shared_region_t *) shared;
+  transaction_t *transaction = (transaction_t *) tx;
+  size_t alignment = region->alignment;
+  for (size_t offset = 0; offset < size; offset += alignment) {
+    void const *word = (void const *) ((uintptr_t) source + offset);
+    void *copy = (void *) ((uintptr_t) target + offset);
+    size_t entry = find_write(region, transaction, word);
+    if (entry < transaction->write_set.size) { // read-after-write
+      memcpy(copy, vector_get(&(transaction->write_values), entry),
+        alignment);
+      continue;
+    }
+    // invisible read: the word's consistent if its stripe, unlocked, kept the
+    // same version (not after the snapshot) around the copy
+    stripe_lock_t *lock = get_lock(region, word);
+    uint64_t before = atomic_load_explicit(lock, memory_order_acquire);
+    memcpy(copy, word, alignment);
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t after = atomic_load_explicit(lock, memory_order_relaxed);
+    if (unlikely(before != after || stripe_is_locked(before)
+      || stripe_version(before) > transaction->read_version)) {
+      abort_transaction(region, transaction);
+      return false;
+    }
+    if (!transaction->is_ro) {
+      stripe_lock_t **slot = vector_push(&(transaction->read_set));
+      if (unlikely(!slot)) {
+        abort_transaction(region, transaction);
+        return false;
+      }
+      *slot = lock;
+    }
+  }
+  return true;
+}
+
+/** [thread-safe] Write operation in the given transaction, source in a private
+ *region and target in the shared region.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param source Source start address (in a private region)
+ * @param size   Length to copy (in bytes), must be a positive multiple of the
+ *alignment
+ * @param target Target start address (in the shared region)
+ * @return Whether the whole transaction can continue
+ **/
+bool tm_write(shared_t shared, tx_t tx,
+  void const *source, size_t size,
+  void *target) {
+  shared_region_t *region = (shared_region_t *) shared;
+  transaction_t *transaction = (transaction_t *) tx;
+  size_t alignment = region->alignment;
+  for (size_t offset = 0; offset < size; offset += alignment) {
+    void *word = (void *) ((uintptr_t) target + offset);
+    void const *value = (void const *) ((uintptr_t) source + offset);
+    size_t entry = find_write(region, transaction, word);
+    if (entry == transaction->write_set.size) { // buffered until commit
+      if (unlikely(!index_reserve(region, transaction))) {
+        abort_transaction(region, transaction);
+        return false;
+      }
+      write_entry_t *write = vector_push(&(transaction->write_set));
+      if (unlikely(!write)) {
+        abort_transaction(region, transaction);
+        return false;
+      }
+      if (unlikely(!vector_push(&(transaction->write_values)))) {
+        transaction->write_set.size--;
+        abort_transaction(region, transaction);
+        return false;
+      }
+      write->target = word;
+      write->lock = get_lock(region, word);
+      write->owns_lock = false;
+      index_insert(region, transaction, entry);
+    }
+    memcpy(vector_get(&(transaction->write_values), entry), value, alignment);
+  }
+  return true;
+}
+
+/** [thread-safe] Memory allocation in the given transaction.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param size   Allocation requested size (in bytes), must be a positive
+ *multiple of the alignment
+ * @param target Pointer in private memory receiving the address of the first
+ *byte of the newly allocated, aligned segment
+ * @return Whether the whole transaction can continue (success/nomem), or not
+ *(abort_alloc)
+ **/
+alloc_t tm_alloc(shared_t shared, tx_t tx, size_t size,
+  void **target) {
+  shared_region_t *region = (shared_region_t *) shared;
+  transaction_t *transaction = (transaction_t *) tx;
+  segment_node_t **slot = vector_push(&(transaction->allocated));
+  if (unlikely(!slot)) {
+    return nomem_alloc;
+  }
+  size_t header_align = region->alignment < sizeof(void *)
+    ? sizeof(void *) : region->alignment;
+  segment_node_t *node;
+  if (unlikely(posix_memalign((void **) &node, header_align,
+    region->header_size + size) != 0)) {
+    transaction->allocated.size--;
+    return nomem_alloc;
+  }
+  // nobody else can reach the segment before its address is published
+  memset(segment_words(region, node), 0, size);
+  node->prev = NULL;
+  lock_acquire(&(region->segments_lock));
+  node->next = region->segments;
+  if (node->next) {
+    node->next->prev = node;
+  }
+  region->segments = node;
+  lock_release(&(region->segments_lock));
+  *slot = node;
+  *target = segment_words(region, node);
+  return success_alloc;
+}
+
+/** [thread-safe] Memory freeing in the given transaction.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param target Address of the first byte of the previously allocated segment
+ *to deallocate
+ * @return Whether the whole transaction can continue
+ **/
+bool tm_free(shared_t shared, tx_t tx, void *target) {
+  shared_region_t *region = (shared_region_t *) shared;
+  transaction_t *transaction = (transaction_t *) tx;
+  // only retired if the transaction commits
+  segment_node_t **slot = vector_push(&(transaction->freed));
+  if (unlikely(!slot)) {
+    abort_transaction(region, transaction);
+    return false;
+  }
+  *slot = segment_node(region, target);
+  return true;
+}